@@ -0,0 +1,151 @@
+/**
+ * @file    VerifyBenchmark.cpp
+ * @brief   Cost per message of the trusted and verified input modes on representative Envelopes
+ *
+ * Description:
+ *   Builds snapshot and delta-batch Envelopes of the shapes the feed sends and
+ *   times, per message:
+ *     trusted  - GetEnvelope and a walk over every level/order or event (what
+ *                decoding touches), no verification
+ *     verified - VerifyEnvelopeBuffer with the processor's default limits,
+ *                then the same walk
+ *   The difference is what input_verification.default_mode: verified costs.
+ *
+ *   Usage: verify_benchmark [min_seconds_per_case]   (default 0.5)
+ */
+
+#include "orderbook_generated.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+namespace fb = ::md;
+
+namespace {
+
+constexpr uint32_t kMaxDepth = 64;         // ProcessorConfig::verifier_max_depth default
+constexpr uint32_t kMaxTables = 1000000;   // ProcessorConfig::verifier_max_tables default
+
+struct Payload {
+    std::string name;
+    std::vector<uint8_t> bytes;
+};
+
+Payload make_snapshot(uint32_t levels_per_side, uint32_t orders_per_level) {
+    ::flatbuffers::FlatBufferBuilder fbb;
+    uint64_t order_id = 1;
+    auto build_side = [&](fb::Side side, uint64_t best, int64_t step) {
+        std::vector<::flatbuffers::Offset<fb::OrderMsgLevel>> levels;
+        for (uint32_t i = 0; i < levels_per_side; ++i) {
+            std::vector<::flatbuffers::Offset<fb::OrderMsgOrder>> orders;
+            for (uint32_t j = 0; j < orders_per_level; ++j) {
+                orders.push_back(fb::CreateOrderMsgOrder(fbb, order_id++, 100 + j, side));
+            }
+            levels.push_back(fb::CreateOrderMsgLevelDirect(fbb, best + step * static_cast<int64_t>(i), &orders));
+        }
+        return levels;
+    };
+    auto bids = build_side(fb::Side_Buy, 1000000, -100);
+    auto asks = build_side(fb::Side_Sell, 1000100, 100);
+    auto snapshot = fb::CreateOrderBookSnapshotDirect(fbb, "BHP.ASX", 123456, &bids, &asks, 1000050, 10);
+    fbb.Finish(fb::CreateEnvelope(fbb, fb::BookMsg_OrderBookSnapshot, snapshot.Union()));
+
+    const uint8_t* data = fbb.GetBufferPointer();
+    return {"snapshot " + std::to_string(levels_per_side) + "x" + std::to_string(orders_per_level),
+            std::vector<uint8_t>(data, data + fbb.GetSize())};
+}
+
+Payload make_delta_batch(uint32_t events) {
+    ::flatbuffers::FlatBufferBuilder fbb;
+    std::vector<::flatbuffers::Offset<fb::FBBookDeltaEvent>> built;
+    for (uint32_t i = 0; i < events; ++i) {
+        built.push_back(fb::CreateFBBookDeltaEvent(fbb, static_cast<fb::Kind>(i % 4), 1 + i, 1000000 + i % 10,
+                                                   100, i % 2 ? fb::Side_Sell : fb::Side_Buy, 5000 + i));
+    }
+    auto batch = fb::CreateDeltaBatchDirect(fbb, "BHP.ASX", 5000, 5000 + events - 1, &built);
+    fbb.Finish(fb::CreateEnvelope(fbb, fb::BookMsg_DeltaBatch, batch.Union()));
+
+    const uint8_t* data = fbb.GetBufferPointer();
+    return {"delta batch " + std::to_string(events), std::vector<uint8_t>(data, data + fbb.GetSize())};
+}
+
+// Reads every field decoding would read, so both modes pay the same access cost
+uint64_t walk(const uint8_t* data) {
+    const fb::Envelope* envelope = fb::GetEnvelope(data);
+    uint64_t sum = 0;
+    if (const auto* snapshot = envelope->msg_as_OrderBookSnapshot()) {
+        for (const auto* side : {snapshot->buy_side(), snapshot->sell_side()}) {
+            if (!side) continue;
+            for (uint32_t i = 0; i < side->size(); ++i) {
+                const auto* level = side->Get(i);
+                sum += level->price();
+                if (!level->orders()) continue;
+                for (uint32_t j = 0; j < level->orders()->size(); ++j) sum += level->orders()->Get(j)->qty();
+            }
+        }
+    } else if (const auto* batch = envelope->msg_as_DeltaBatch()) {
+        if (batch->events()) {
+            for (uint32_t i = 0; i < batch->events()->size(); ++i) {
+                const auto* event = batch->events()->Get(i);
+                sum += event->price() + event->qty();
+            }
+        }
+    }
+    return sum;
+}
+
+bool verify(const Payload& payload) {
+    ::flatbuffers::Verifier::Options options;
+    options.max_depth = kMaxDepth;
+    options.max_tables = kMaxTables;
+    ::flatbuffers::Verifier verifier(payload.bytes.data(), payload.bytes.size(), options);
+    return fb::VerifyEnvelopeBuffer(verifier);
+}
+
+// Nanoseconds per call of fn, repeated for at least min_seconds
+template <typename Fn>
+double time_per_call(double min_seconds, Fn&& fn) {
+    using Clock = std::chrono::steady_clock;
+    uint64_t iterations = 0;
+    const auto start = Clock::now();
+    double elapsed = 0;
+    do {
+        for (int i = 0; i < 1000; ++i) fn();
+        iterations += 1000;
+        elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+    } while (elapsed < min_seconds);
+    return elapsed * 1e9 / static_cast<double>(iterations);
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    const double min_seconds = argc > 1 ? std::atof(argv[1]) : 0.5;
+
+    const std::vector<Payload> payloads = {
+        make_snapshot(10, 1), make_snapshot(10, 5), make_snapshot(50, 5), make_snapshot(200, 10),
+        make_delta_batch(10), make_delta_batch(100),
+    };
+
+    volatile uint64_t sink = 0;
+    std::printf("%-22s %10s %12s %12s %12s %9s\n", "payload", "bytes", "trusted ns", "verified ns", "verify ns",
+                "overhead");
+    for (const auto& payload : payloads) {
+        if (!verify(payload)) {
+            std::fprintf(stderr, "%s: payload failed verification\n", payload.name.c_str());
+            return 1;
+        }
+
+        const double trusted = time_per_call(min_seconds, [&] { sink = sink + walk(payload.bytes.data()); });
+        const double verified = time_per_call(min_seconds, [&] {
+            if (verify(payload)) sink = sink + walk(payload.bytes.data());
+        });
+        const double verify_only = time_per_call(min_seconds, [&] { sink = sink + verify(payload); });
+
+        std::printf("%-22s %10zu %12.1f %12.1f %12.1f %8.0f%%\n", payload.name.c_str(), payload.bytes.size(),
+                    trusted, verified, verify_only, 100.0 * (verified - trusted) / trusted);
+    }
+    return 0;
+}
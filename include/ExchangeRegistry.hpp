@@ -0,0 +1,89 @@
+/**
+ * @file    ExchangeRegistry.hpp
+ * @brief   Per-process table of exchange names behind compact ExchangeIds
+ *
+ * Developer: Equix Technologies
+ * Copyright: Equix Technologies Pty Ltd
+ * Created: June 2025
+ *
+ * Description:
+ *   Price levels carry the venues that contribute to them as an ExchangeMask
+ *   instead of a list of names. The registry assigns each venue a bit and
+ *   keeps its name JSON-escaped once, so output renders a level's exchanges
+ *   straight from the mask without copying or escaping strings.
+ */
+
+#pragma once
+
+#ifndef EXCHANGE_REGISTRY_HPP_
+#define EXCHANGE_REGISTRY_HPP_
+
+#include "JsonWriter.hpp"
+#include "OrderBookTypes.hpp"
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace market_depth {
+
+/**
+ * @brief Exchange name <-> ExchangeId table
+ *
+ * Populated at start-up and read-only afterwards; reads are then safe from
+ * any thread without locking.
+ */
+class ExchangeRegistry {
+public:
+    /**
+     * @brief Returns the id for name, registering it if new
+     * @throws std::length_error if kMaxExchanges venues are already registered
+     */
+    ExchangeId register_exchange(std::string_view name) {
+        for (size_t id = 0; id < names_.size(); ++id) {
+            if (names_[id] == name) return static_cast<ExchangeId>(id);
+        }
+        if (names_.size() >= kMaxExchanges) {
+            throw std::length_error("ExchangeRegistry: more than " + std::to_string(kMaxExchanges) + " exchanges");
+        }
+
+        names_.emplace_back(name);
+
+        // Pre-serialize the JSON string once; keep it without the surrounding quotes
+        std::string quoted;
+        JsonWriter(quoted).value(name);
+        escaped_names_.push_back(quoted.substr(1, quoted.size() - 2));
+
+        return static_cast<ExchangeId>(names_.size() - 1);
+    }
+
+    const std::string& name(ExchangeId id) const { return names_[id]; }
+
+    /**
+     * @brief JSON-escaped name, without quotes (for JsonWriter::value_unescaped)
+     */
+    const std::string& escaped_name(ExchangeId id) const { return escaped_names_[id]; }
+
+    size_t size() const { return names_.size(); }
+
+    /**
+     * @brief Calls fn(id) for every registered exchange in mask, lowest id first
+     */
+    template <typename Fn>
+    void for_each(ExchangeMask mask, Fn&& fn) const {
+        while (mask != 0) {
+            const auto id = static_cast<ExchangeId>(__builtin_ctzll(mask));
+            if (id >= names_.size()) return;
+            fn(id);
+            mask &= mask - 1;
+        }
+    }
+
+private:
+    std::vector<std::string> names_;
+    std::vector<std::string> escaped_names_;
+};
+
+} // namespace market_depth
+
+#endif /* EXCHANGE_REGISTRY_HPP_ */
@@ -0,0 +1,139 @@
+/**
+ * @file    FlightRecorder.hpp
+ * @brief   Lock-free ring of the most recent slow messages, dumpable on demand
+ *
+ * Developer: Equix Technologies
+ * Copyright: Equix Technologies Pty Ltd
+ * Created: June 2025
+ *
+ * Description:
+ *   Messages whose processing exceeds monitoring.slow_processing_threshold_us
+ *   are recorded with enough context (symbol, partition, offset, level counts,
+ *   per-stage timings, payload size) to find the exact input behind a tail
+ *   latency outlier. Writers claim a slot with one fetch_add and publish it
+ *   with a per-slot sequence number; the ring never blocks and old entries are
+ *   simply overwritten. A reader copies each slot and discards it if a writer
+ *   touched it meanwhile.
+ */
+
+#pragma once
+
+#ifndef FLIGHT_RECORDER_HPP_
+#define FLIGHT_RECORDER_HPP_
+
+#include "LatencyHistogram.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <string_view>
+#include <vector>
+
+namespace market_depth {
+
+/**
+ * @brief One slow message; trivially copyable so slots can be copied under a sequence check
+ */
+struct SlowMessageRecord {
+    static constexpr size_t kMaxSymbolLength = 31;
+
+    uint64_t wall_time_us = 0;                     // When processing finished
+    uint64_t total_ns = 0;                         // Whole message through the processor
+    uint64_t stage_ns[kLatencyStageCount] = {};    // Indexed by LatencyStage (summed over depth views)
+    int64_t offset = -1;
+    int32_t partition = -1;
+    uint32_t payload_bytes = 0;
+    uint32_t bid_levels = 0;                       // Levels in the converted ladder
+    uint32_t ask_levels = 0;
+    uint32_t views_published = 0;
+    char symbol[kMaxSymbolLength + 1] = {};
+
+    void set_symbol(std::string_view name) {
+        const size_t length = std::min(name.size(), kMaxSymbolLength);
+        std::memcpy(symbol, name.data(), length);
+        symbol[length] = '\0';
+    }
+};
+
+/**
+ * @brief Multi-writer, overwrite-oldest ring of SlowMessageRecords
+ */
+class FlightRecorder {
+public:
+    explicit FlightRecorder(size_t capacity)
+        : capacity_(std::max<size_t>(capacity, 1)), slots_(new Slot[capacity_]), next_(0), dropped_(0) {}
+
+    /**
+     * @brief Store a record (any thread, never blocks)
+     */
+    void record(const SlowMessageRecord &record) {
+        const uint64_t ticket = next_.fetch_add(1, std::memory_order_relaxed);
+        Slot &slot = slots_[ticket % capacity_];
+
+        // Odd sequence = being written; readers skip the slot until it is even again.
+        // The write is dropped if the slot is being written or already holds a newer
+        // ticket (this writer was delayed past a full lap of the ring).
+        uint64_t current = slot.sequence.load(std::memory_order_relaxed);
+        const uint64_t sequence = 2 * ticket + 1;
+        if ((current & 1) || current > sequence ||
+            !slot.sequence.compare_exchange_strong(current, sequence, std::memory_order_relaxed)) {
+            dropped_.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        std::atomic_thread_fence(std::memory_order_release);
+        slot.record = record;
+        slot.sequence.store(sequence + 1, std::memory_order_release);
+    }
+
+    /**
+     * @brief Copy of the retained records, oldest first
+     */
+    std::vector<SlowMessageRecord> snapshot() const {
+        std::vector<SlowMessageRecord> records;
+        const uint64_t end = next_.load(std::memory_order_acquire);
+        const uint64_t begin = end > capacity_ ? end - capacity_ : 0;
+        records.reserve(static_cast<size_t>(end - begin));
+
+        for (uint64_t ticket = begin; ticket < end; ++ticket) {
+            const Slot &slot = slots_[ticket % capacity_];
+            const uint64_t expected = 2 * ticket + 2;
+            if (slot.sequence.load(std::memory_order_acquire) != expected) continue;  // Being (re)written
+            SlowMessageRecord copy = slot.record;
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (slot.sequence.load(std::memory_order_relaxed) != expected) continue;  // Torn copy
+            records.push_back(copy);
+        }
+        return records;
+    }
+
+    /**
+     * @brief Records written since start (including overwritten ones)
+     */
+    uint64_t recorded() const { return next_.load(std::memory_order_relaxed); }
+
+    /**
+     * @brief Records lost to a concurrent or newer write of the same slot
+     */
+    uint64_t dropped() const { return dropped_.load(std::memory_order_relaxed); }
+
+    size_t capacity() const { return capacity_; }
+
+    FlightRecorder(const FlightRecorder &) = delete;
+    FlightRecorder &operator=(const FlightRecorder &) = delete;
+
+private:
+    struct alignas(64) Slot {
+        std::atomic<uint64_t> sequence{0};
+        SlowMessageRecord record;
+    };
+
+    const size_t capacity_;
+    std::unique_ptr<Slot[]> slots_;
+    std::atomic<uint64_t> next_;
+    std::atomic<uint64_t> dropped_;
+};
+
+} // namespace market_depth
+
+#endif /* FLIGHT_RECORDER_HPP_ */
@@ -0,0 +1,168 @@
+/**
+ * @file    JsonWriter.hpp
+ * @brief   Streaming JSON writer that appends straight into a byte buffer
+ *
+ * Developer: Equix Technologies
+ * Copyright: Equix Technologies Pty Ltd
+ * Created: June 2025
+ *
+ * Description:
+ *   Emits JSON token by token into a caller-owned std::string without
+ *   building a document tree. The layout matches nlohmann::json::dump():
+ *   indent < 0 gives the compact form, indent >= 0 the pretty form with that
+ *   many spaces per level. Callers are responsible for writing object keys in
+ *   the order they want them to appear (nlohmann sorts keys alphabetically).
+ */
+
+#pragma once
+
+#ifndef JSON_WRITER_HPP_
+#define JSON_WRITER_HPP_
+
+#include <charconv>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+namespace market_depth {
+
+/**
+ * @brief Append-only JSON writer over a reusable buffer
+ *
+ * The buffer is not cleared, so several documents can share one allocation
+ * when the caller clears it between uses. Nesting is limited to kMaxNesting.
+ */
+class JsonWriter {
+public:
+    static constexpr int kMaxNesting = 16;
+
+    explicit JsonWriter(std::string& out, int indent = -1)
+        : out_(out), indent_(indent), depth_(0), after_key_(false) {}
+
+    void begin_object() { open('{'); }
+    void end_object() { close('}'); }
+    void begin_array() { open('['); }
+    void end_array() { close(']'); }
+
+    void key(std::string_view name) {
+        separate();
+        write_string(name);
+        out_.append(indent_ >= 0 ? ": " : ":");
+        after_key_ = true;
+    }
+
+    void value(std::string_view str) {
+        separate();
+        write_string(str);
+    }
+
+    void value(const char* str) { value(std::string_view(str)); }
+
+    void value(uint64_t number) {
+        separate();
+        char digits[20];
+        auto result = std::to_chars(digits, digits + sizeof(digits), number);
+        out_.append(digits, static_cast<size_t>(result.ptr - digits));
+    }
+
+    void value(uint32_t number) { value(static_cast<uint64_t>(number)); }
+
+    void value(bool flag) {
+        separate();
+        out_.append(flag ? "true" : "false");
+    }
+
+    /**
+     * @brief Write pre-rendered characters as a string value (caller guarantees no escaping is needed)
+     */
+    void value_unescaped(const char* str, size_t length) {
+        separate();
+        out_.push_back('"');
+        out_.append(str, length);
+        out_.push_back('"');
+    }
+
+    template <typename T>
+    void field(std::string_view name, const T& v) {
+        key(name);
+        value(v);
+    }
+
+private:
+    void open(char bracket) {
+        separate();
+        out_.push_back(bracket);
+        has_items_[depth_++] = false;
+    }
+
+    void close(char bracket) {
+        --depth_;
+        if (indent_ >= 0 && has_items_[depth_]) {
+            newline(depth_);
+        }
+        out_.push_back(bracket);
+    }
+
+    // Emits the separator that precedes a new element of the current container
+    void separate() {
+        if (after_key_) {
+            after_key_ = false;
+            return;
+        }
+        if (depth_ == 0) return;
+
+        bool& has_items = has_items_[depth_ - 1];
+        if (has_items) {
+            out_.push_back(',');
+        }
+        has_items = true;
+        if (indent_ >= 0) {
+            newline(depth_);
+        }
+    }
+
+    void newline(int level) {
+        out_.push_back('\n');
+        out_.append(static_cast<size_t>(level) * static_cast<size_t>(indent_), ' ');
+    }
+
+    void write_string(std::string_view str) {
+        static constexpr char kHex[] = "0123456789abcdef";
+
+        out_.push_back('"');
+        size_t run_start = 0;
+        for (size_t i = 0; i < str.size(); ++i) {
+            const auto c = static_cast<unsigned char>(str[i]);
+            if (c >= 0x20 && c != '"' && c != '\\') continue;
+
+            out_.append(str.data() + run_start, i - run_start);
+            run_start = i + 1;
+            switch (c) {
+                case '"':  out_.append("\\\""); break;
+                case '\\': out_.append("\\\\"); break;
+                case '\b': out_.append("\\b"); break;
+                case '\f': out_.append("\\f"); break;
+                case '\n': out_.append("\\n"); break;
+                case '\r': out_.append("\\r"); break;
+                case '\t': out_.append("\\t"); break;
+                default: {
+                    const char escaped[6] = {'\\', 'u', '0', '0', kHex[c >> 4], kHex[c & 0x0F]};
+                    out_.append(escaped, sizeof(escaped));
+                    break;
+                }
+            }
+        }
+        out_.append(str.data() + run_start, str.size() - run_start);
+        out_.push_back('"');
+    }
+
+    std::string& out_;
+    const int indent_;
+    int depth_;
+    bool after_key_;
+    bool has_items_[kMaxNesting];
+};
+
+} // namespace market_depth
+
+#endif /* JSON_WRITER_HPP_ */
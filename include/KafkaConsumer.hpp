@@ -17,12 +17,26 @@
 #ifndef KAFKA_CONSUMER_HPP_
 #define KAFKA_CONSUMER_HPP_
 
+#include "KafkaStatistics.hpp"
 #include <librdkafka/rdkafka.h>
 #include <string>
 #include <vector>
+#include <utility>
 #include <unordered_set>
 #include <mutex>
 #include <shared_mutex>
+#include <atomic>
+
+/**
+ * @brief Consume position and lag of one assigned partition.
+ */
+struct PartitionLag {
+    std::string topic;
+    int32_t partition = 0;
+    int64_t position = -1;         /* Next offset to consume, -1 if not known yet. */
+    int64_t high_watermark = -1;   /* Cached high watermark, -1 if not known yet. */
+    int64_t lag = -1;              /* high_watermark - position, -1 if either is unknown. */
+};
 
 /**
  * @class KafkaConsumer
@@ -56,6 +70,107 @@ public:
      */
     rd_kafka_message_t* consume(int timeout_ms = 100);
 
+    /**
+     * @brief Polls up to max_messages messages from the consumer queue in one call.
+     *
+     *        Built on rd_kafka_consume_batch_queue(): waits up to timeout_ms for the
+     *        first message and returns whatever is available, so a burst is drained
+     *        with a single lock and wake-up. Messages of a partition that is moved
+     *        forward to the catch-up lookback are dropped, see seek_lagging_partitions().
+     * @param messages Output array with room for max_messages pointers.
+     * @param max_messages Capacity of the messages array.
+     * @param timeout_ms Poll timeout in milliseconds.
+     * @return Number of messages stored in messages (0 on timeout or error).
+     *         Caller is responsible for rd_kafka_message_destroy() on each.
+     */
+    size_t consume_batch(rd_kafka_message_t** messages, size_t max_messages, int timeout_ms = 100);
+
+    /**
+     * @brief Splits assigned partitions off the consumer queue onto worker queues.
+     *
+     *        On every assignment, each partition's queue is obtained with
+     *        rd_kafka_queue_get_partition() and forwarded to worker queue
+     *        (partition % num_queues), so one worker sees all messages of its
+     *        partitions in order. Must be called after initialize() and before
+     *        the first poll. The consumer queue must still be polled with
+     *        consume() to serve rebalance events.
+     * @param num_queues Number of worker queues to create.
+     */
+    void enable_partition_queues(size_t num_queues);
+
+    /**
+     * @brief Polls a message from a worker queue created by enable_partition_queues().
+     * @param queue_index Worker queue index in [0, partition_queue_count()).
+     * @param timeout_ms Poll timeout in milliseconds.
+     * @return Pointer to rd_kafka_message_t, or nullptr if no message.
+     *         Caller is responsible for rd_kafka_message_destroy().
+     */
+    rd_kafka_message_t* consume_partition_queue(size_t queue_index, int timeout_ms = 100);
+
+    /**
+     * @brief Batch variant of consume_partition_queue(), see consume_batch().
+     */
+    size_t consume_partition_batch(size_t queue_index, rd_kafka_message_t** messages,
+                                   size_t max_messages, int timeout_ms = 100);
+
+    /**
+     * @brief Returns the number of worker queues (0 if partition queues are disabled).
+     */
+    size_t partition_queue_count() const { return partition_queues_.size(); }
+
+    /**
+     * @brief Returns the configured batch size (kafka_consumer.max_poll_records).
+     */
+    size_t max_poll_records() const { return max_poll_records_; }
+
+    /**
+     * @brief Pauses fetching for every assigned partition (flow control).
+     *
+     *        Partitions assigned later by a rebalance are paused as well until
+     *        resume_assignment() is called.
+     * @return true if the assignment is now paused.
+     */
+    bool pause_assignment();
+
+    /**
+     * @brief Resumes fetching for every assigned partition.
+     * @return true if the assignment is now resumed.
+     */
+    bool resume_assignment();
+
+    /**
+     * @brief Returns true while the assignment is paused.
+     */
+    bool is_paused() const { return paused_.load(std::memory_order_relaxed); }
+
+    /**
+     * @brief Consumer lag behind the partition high watermark after msg, from cached watermarks.
+     *
+     *        Uses rd_kafka_get_watermark_offsets(), which does not block; the high
+     *        watermark is refreshed by every fetch response.
+     * @return Lag in messages, or -1 if the watermark is not known yet.
+     */
+    int64_t lag(const rd_kafka_message_t* msg) const;
+
+    /**
+     * @brief Lag (messages) above which a partition is considered catching up (0 = disabled).
+     */
+    int64_t catchup_lag_threshold() const { return catchup_lag_threshold_; }
+
+    /**
+     * @brief Position and lag of every assigned partition, for monitoring.
+     *
+     *        Built from rd_kafka_position() and cached watermarks only, so it never
+     *        waits on the broker.
+     */
+    std::vector<PartitionLag> partition_lags() const;
+
+    /**
+     * @brief Gauges from librdkafka statistics (kafka_consumer.statistics_interval_ms; 0 = off).
+     *        Served by the consumer queue, i.e. from the processing loop's polls.
+     */
+    const KafkaStatistics& statistics() const { return statistics_; }
+
     /**
      * @brief Clean shutdown and resource release.
      */
@@ -79,17 +194,75 @@ private:
      */
     void parse_config(const std::string& config_path);
 
+    /**
+     * @brief librdkafka rebalance callback; assigns partitions and splits their queues.
+     */
+    static void rebalance_cb(rd_kafka_t* rk, rd_kafka_resp_err_t err,
+                             rd_kafka_topic_partition_list_t* partitions, void* opaque);
+
+    /**
+     * @brief librdkafka statistics callback; parses the JSON into statistics_.
+     */
+    static int stats_cb(rd_kafka_t* rk, char* json, size_t json_len, void* opaque);
+
+    /**
+     * @brief Forwards each assigned partition queue to its worker queue.
+     */
+    void forward_partition_queues(rd_kafka_t* rk, const rd_kafka_topic_partition_list_t* partitions);
+
+    /**
+     * @brief Moves far-behind partitions forward to the catch-up lookback.
+     *
+     *        Partitions assigned while catchup_lookback_ms is set are pending until
+     *        their first message arrives: its offset is where the partition started
+     *        and the fetch that returned it refreshed the cached high watermark, so
+     *        the lag check needs no broker round trip. Partitions more than
+     *        catchup_lag_threshold behind get one batched rd_kafka_offsets_for_times()
+     *        lookup for now - catchup_lookback_ms and are seeked there; their messages
+     *        from before the new start are dropped from the batch.
+     *        Called from the consuming thread, never from the rebalance callback.
+     * @return Messages left in the batch.
+     */
+    size_t seek_lagging_partitions(rd_kafka_message_t** messages, size_t count);
+
+    /**
+     * @brief Adds newly assigned partitions to, or drops revoked ones from, the lookback check.
+     * @param partitions Partitions to add or drop; nullptr drops all.
+     * @param assigned true to add the partitions, false to drop them.
+     */
+    void update_lookback_pending(const rd_kafka_topic_partition_list_t* partitions, bool assigned);
+
+    /**
+     * @brief Pauses or resumes the current assignment, see pause_assignment().
+     */
+    bool set_assignment_paused(bool pause);
+
     /* YAML-derived config */
     std::string bootstrap_servers_;
     std::string group_id_;
     std::string session_timeout_ms_;
     std::string auto_offset_reset_;
     std::string enable_auto_commit_;
+    size_t max_poll_records_;
+    int64_t catchup_lag_threshold_;      /* Lag (messages) that triggers catch-up; 0 disables it. */
+    int64_t catchup_lookback_ms_;        /* How far back a lagging partition restarts; 0 = no seek. */
+    int statistics_interval_ms_;         /* librdkafka statistics.interval.ms; 0 disables statistics. */
+    KafkaStatistics statistics_;
     std::unordered_set<std::string> subscribed_topics_;
 
     rd_kafka_t* consumer_;
+    rd_kafka_queue_t* consumer_queue_;   /* Consumer queue handle for batch consumption. */
     mutable std::shared_mutex consumer_mutex_;
     bool initialized_;
+    std::atomic<bool> paused_;           /* Assignment paused for flow control. */
+
+    /* Assigned partitions whose start has not been checked against the catch-up lookback yet. */
+    std::mutex lookback_mutex_;
+    std::vector<std::pair<std::string, int32_t>> lookback_pending_;
+    std::atomic<size_t> lookback_pending_count_;
+
+    /* Worker queues; sized once by enable_partition_queues() before consumption starts. */
+    std::vector<rd_kafka_queue_t*> partition_queues_;
 };
 
 #endif /* KAFKA_CONSUMER_HPP_ */
\ No newline at end of file
@@ -17,12 +17,27 @@
 #ifndef KAFKA_PRODUCER_HPP_
 #define KAFKA_PRODUCER_HPP_
 
+#include "KafkaStatistics.hpp"
+#include "LatencyHistogram.hpp"
+#include "OutputBufferPool.hpp"
 #include <librdkafka/rdkafka.h>
 #include <string>
 #include <vector>
 #include <unordered_map>
 #include <shared_mutex>
 #include <mutex>
+#include <atomic>
+#include <thread>
+
+/**
+ * @brief Delivery outcome counters maintained by the delivery-report callback.
+ */
+struct DeliveryStats {
+    uint64_t delivered = 0;         /* Messages acknowledged by the broker. */
+    uint64_t failed = 0;            /* Messages that permanently failed delivery. */
+    uint64_t parked = 0;            /* Messages parked in the retry ring after QUEUE_FULL. */
+    uint64_t dropped = 0;           /* Messages dropped because the retry ring was full. */
+};
 
 /**
  * @class KafkaProducer
@@ -78,6 +93,61 @@ public:
      */
     rd_kafka_topic_t* get_or_create_topic(const std::string& topic_name);
 
+    /**
+     * @brief Pool of zero-copy payload buffers; buffers produced with the
+     *        OutputBuffer* as message opaque are returned here on delivery.
+     */
+    OutputBufferPool& buffer_pool() { return buffer_pool_; }
+
+    /**
+     * @brief Returns a snapshot of the delivery counters.
+     */
+    DeliveryStats delivery_stats() const;
+
+    /**
+     * @brief Produce-to-ack latency of delivered messages, in nanoseconds.
+     */
+    const market_depth::LatencyHistogram& delivery_latency() const { return delivery_latency_; }
+
+    /**
+     * @brief Input Kafka timestamp to delivery acknowledgement, per input partition (nanoseconds).
+     *        Only recorded for buffers that carry an ingest timestamp.
+     */
+    const market_depth::PartitionLatencyRecorder& ingest_delivery_latency() const { return ingest_delivery_latency_; }
+
+    /**
+     * @brief Gauges from librdkafka statistics (kafka_cluster.statistics_interval_ms; 0 = off).
+     *        Per-partition sections are skipped: output spans one topic per symbol.
+     */
+    const KafkaStatistics& statistics() const { return statistics_; }
+
+    /**
+     * @brief Produces a pooled buffer without copying; ownership passes to the producer.
+     *
+     *        If the local queue is full (or earlier messages are still waiting) the
+     *        message is parked in the bounded retry ring and re-produced by the
+     *        service thread as the queue drains. The buffer is released immediately
+     *        on any other error, or if the ring is full.
+     * @return true if the message was enqueued or parked for retry.
+     * @note Thread-safe.
+     */
+    bool produce_buffer(rd_kafka_topic_t* topic, int32_t partition, OutputBuffer* buffer);
+
+    /**
+     * @brief Messages waiting in librdkafka's queue plus those parked for retry.
+     */
+    size_t queue_depth() const;
+
+    /**
+     * @brief Producer queue capacity (kafka_cluster.queue_buffering_max_messages).
+     */
+    size_t queue_capacity() const { return queue_capacity_; }
+
+    /**
+     * @brief Number of messages currently parked in the retry ring.
+     */
+    size_t retry_pending() const { return retry_count_.load(std::memory_order_relaxed); }
+
     /* Prevent copy/move. */
     KafkaProducer(const KafkaProducer&) = delete;               /* Deleted copy constructor. */
     KafkaProducer& operator=(const KafkaProducer&) = delete;    /* Deleted copy assignment. */
@@ -94,6 +164,36 @@ private:
      */
     void parse_config(const std::string& config_path);
 
+    /**
+     * @brief librdkafka delivery-report callback: recycles the message's OutputBuffer (if any).
+     */
+    static void delivery_report_cb(rd_kafka_t* rk, const rd_kafka_message_t* rkmessage, void* opaque);
+
+    /**
+     * @brief librdkafka statistics callback; parses the JSON into statistics_.
+     */
+    static int stats_cb(rd_kafka_t* rk, char* json, size_t json_len, void* opaque);
+
+    /**
+     * @brief Service thread body: polls librdkafka so delivery reports and
+     *        producer errors are handled off the consume path.
+     */
+    void service_loop();
+
+    /**
+     * @brief Re-produces parked messages in order until the queue is full again.
+     */
+    void drain_retry_ring();
+
+    /**
+     * @brief A message rejected with QUEUE_FULL, waiting to be produced again.
+     */
+    struct PendingMessage {
+        rd_kafka_topic_t* topic;
+        int32_t partition;
+        OutputBuffer* buffer;
+    };
+
     /* Config loaded from YAML or other source. */
     std::string bootstrap_servers_;        /* Kafka bootstrap servers (comma-separated). */
     std::string compression_;              /* Compression codec (e.g. "snappy"). */
@@ -101,11 +201,30 @@ private:
     std::string queue_buffering_max_messages_;
     std::string batch_num_messages_;
     std::string linger_ms_;
+    size_t queue_capacity_;                /* queue_buffering_max_messages as a number. */
+    size_t retry_ring_size_;               /* Capacity of the QUEUE_FULL retry ring. */
+    int statistics_interval_ms_;           /* librdkafka statistics.interval.ms; 0 disables statistics. */
+    KafkaStatistics statistics_;           /* Updated from the service thread's polls. */
     std::vector<std::string> topics_;      /* List of topics (symbols) loaded from config. */
 
     rd_kafka_t* producer_;                                        /* Underlying librdkafka producer. */
     std::unordered_map<std::string, rd_kafka_topic_t*> topic_cache_; /* Cache of topic handles by topic name. */
     mutable std::shared_mutex topic_cache_mutex_;                 /* Mutex for thread-safe topic cache access. */
+    OutputBufferPool buffer_pool_;                                /* Zero-copy payload buffers, recycled on delivery. */
+
+    std::thread service_thread_;                                  /* Polls the producer (delivery reports). */
+    std::atomic<bool> service_running_;                           /* Cleared to stop the service thread. */
+    std::atomic<uint64_t> delivered_;                             /* Delivery counters, see DeliveryStats. */
+    std::atomic<uint64_t> delivery_failures_;
+    market_depth::LatencyHistogram delivery_latency_;             /* Produce-to-ack latency (ns); written by delivery reports only. */
+    market_depth::PartitionLatencyRecorder ingest_delivery_latency_; /* Input timestamp-to-ack latency per input partition. */
+
+    std::vector<PendingMessage> retry_ring_;                      /* Circular buffer of parked messages. */
+    size_t retry_head_;                                           /* Index of the oldest parked message. */
+    std::atomic<size_t> retry_count_;                             /* Parked messages (read lock-free). */
+    mutable std::mutex retry_mutex_;                              /* Guards retry_ring_ and retry_head_. */
+    std::atomic<uint64_t> retry_parked_;
+    std::atomic<uint64_t> retry_dropped_;
     bool initialized_;                                            /* Initialization status. */
 };
 
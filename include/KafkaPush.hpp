@@ -1,6 +1,6 @@
 /**
  * @file    KafkaPush.hpp
- * @brief   Inline function for pushing messages to a Kafka topic (thread-safe).
+ * @brief   Inline function for pushing pooled buffers to a Kafka topic (thread-safe).
  *
  * Developer: Hoang Nguyen & Tan A. Pham
  * Copyright: Equix Technologies Pty Ltd (contact@equix.com.au)
@@ -9,8 +9,8 @@
  *
  * Description:
  *   Provides an inline helper function for any worker thread to publish
- *   (typically JSON) messages into a given Kafka topic and partition,
- *   using the KafkaProducer singleton backend.
+ *   pooled output buffers into a given Kafka topic and partition without
+ *   copying, using the KafkaProducer singleton backend.
  */
 #pragma once
 
@@ -18,46 +18,33 @@
 #define KAFKA_PUSH_HPP_
 
 #include "KafkaProducer.hpp"
-#include <string>
-#include <cstddef>
-#include <iostream>
+#include "LogThrottle.hpp"
 #include "spdlog/spdlog.h"
 /**
- * @brief   Publishes a message to a Kafka topic and partition (thread-safe).
+ * @brief   Publishes a pooled buffer to a Kafka topic and partition without copying (thread-safe).
  *
- *          Uses the KafkaProducer singleton instance. If the producer or topic handle
- *          is unavailable, logs an error. Errors during publishing (asynchronous) are logged.
+ *          The payload is handed to librdkafka as-is; ownership of the buffer passes to the
+ *          producer, whose delivery-report callback returns it to KafkaProducer::buffer_pool().
+ *          If the local queue is full the message is parked for retry (see
+ *          KafkaProducer::produce_buffer()); otherwise a failed buffer is released immediately.
  *
- * @param   symbol      The Kafka topic name.
+ * @param   topic       Topic handle (see KafkaProducer::get_or_create_topic()).
  * @param   partition   The Kafka partition to publish to.
- * @param   data        Pointer to message payload (typically JSON).
- * @param   len         Size in bytes of the payload.
+ * @param   buffer      Buffer obtained from KafkaProducer::instance().buffer_pool().acquire().
+ *                      Must not be touched by the caller after this call.
  *
- * @note    Safe for calls from multiple threads. If publishing fails, logs error to std::cerr.
+ * @return  true if the message was enqueued or parked for retry.
  */
-inline void KafkaPush(const std::string& symbol, int partition, const void* data, size_t len) {
+inline bool KafkaPushBuffer(rd_kafka_topic_t* topic, int partition, OutputBuffer* buffer) {
     KafkaProducer& kp = KafkaProducer::instance();
-    rd_kafka_t* producer = kp.get_producer();
-    rd_kafka_topic_t* topic = kp.get_or_create_topic(symbol);
-
-    if (!producer || !topic) {
-        SPDLOG_ERROR("Error: Producer or topic ({}) not available!  producer=0x{:X}, topic=0x{:X}",
-             symbol, (uintptr_t)producer, (uintptr_t)topic);
-        return;
+    if (!topic) {
+        MD_ERROR_RATE_LIMITED(10, "Error: topic handle not available!");
+        kp.buffer_pool().release(buffer);
+        return false;
     }
 
-    int ret = rd_kafka_produce(
-        topic,
-        partition,
-        RD_KAFKA_MSG_F_COPY,
-        const_cast<void*>(data), len,
-        nullptr, 0,
-        nullptr);
-    if (ret == -1) {
-        rd_kafka_resp_err_t err = rd_kafka_last_error();
-        SPDLOG_WARN("Push failed for topic {} partition {}: {}", symbol, partition, rd_kafka_err2str(err));
-    }
-    // else: success (asynchronous), nothing to do
+    // QUEUE_FULL parks the message in the producer's retry ring instead of dropping it
+    return kp.produce_buffer(topic, partition, buffer);
 }
 
 #endif
@@ -0,0 +1,119 @@
+/**
+ * @file    KafkaStatistics.hpp
+ * @brief   Structured gauges parsed from librdkafka's periodic statistics JSON.
+ *
+ * Developer: Equix Technologies
+ * Copyright: Equix Technologies Pty Ltd
+ * Created: June 2025
+ *
+ * Description:
+ *   With statistics.interval.ms set, librdkafka emits a JSON document per
+ *   client from its poll path. KafkaStatistics parses it into per-broker and
+ *   per-partition gauges and publishes an immutable snapshot for reporting,
+ *   plus a few lock-free aggregates that the processing loop can read for
+ *   flow-control decisions.
+ */
+
+#pragma once
+
+#ifndef KAFKA_STATISTICS_HPP_
+#define KAFKA_STATISTICS_HPP_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Per-broker connection gauges.
+ */
+struct KafkaBrokerStats {
+    std::string name;
+    std::string state;              /* UP, DOWN, CONNECT, ... */
+    int64_t rtt_avg_us = 0;         /* Request round-trip time over the last window. */
+    int64_t rtt_p99_us = 0;
+    int64_t outbuf_cnt = 0;         /* Requests waiting to be sent. */
+    int64_t waitresp_cnt = 0;       /* Requests in flight, waiting for a response. */
+    int64_t tx_errors = 0;
+    int64_t rx_errors = 0;
+};
+
+/**
+ * @brief Per-partition gauges (consumer clients only).
+ */
+struct KafkaPartitionStats {
+    std::string topic;
+    int32_t partition = 0;
+    int64_t consumer_lag = -1;      /* hi_offset - committed/position; -1 if unknown. */
+    int64_t hi_offset = -1;
+    int64_t committed_offset = -1;
+    int64_t fetchq_cnt = 0;         /* Messages pre-fetched and waiting to be consumed. */
+    int64_t fetchq_size = 0;        /* Bytes in the fetch queue. */
+};
+
+/**
+ * @brief One parsed statistics document.
+ */
+struct KafkaStatsSnapshot {
+    std::string client;             /* librdkafka client instance name. */
+    int64_t msg_cnt = 0;            /* Messages in producer queues. */
+    int64_t msg_size = 0;           /* Bytes in producer queues. */
+    double batch_size_avg = 0;      /* Producer: average bytes per MessageSet. */
+    double batch_cnt_avg = 0;       /* Producer: average messages per MessageSet. */
+    std::vector<KafkaBrokerStats> brokers;
+    std::vector<KafkaPartitionStats> partitions;
+};
+
+/**
+ * @class KafkaStatistics
+ * @brief Parses statistics JSON from the stats callback and holds the latest result.
+ *
+ * update() runs on the librdkafka poll thread of the owning client; readers on
+ * any thread get the last complete snapshot.
+ */
+class KafkaStatistics {
+public:
+    /**
+     * @param keep_partitions Keep per-partition entries. Producers writing to
+     *        many topics should pass false: the partition sections are then
+     *        skipped while parsing, which keeps large documents cheap.
+     */
+    explicit KafkaStatistics(bool keep_partitions);
+
+    /**
+     * @brief Parses one statistics document; malformed input is logged and ignored.
+     */
+    void update(const char* json, size_t len);
+
+    /**
+     * @brief Latest snapshot, or nullptr before the first document.
+     */
+    std::shared_ptr<const KafkaStatsSnapshot> snapshot() const;
+
+    /* Lock-free aggregates of the latest snapshot. */
+    int64_t total_consumer_lag() const { return total_consumer_lag_.load(std::memory_order_relaxed); }
+    int64_t max_consumer_lag() const { return max_consumer_lag_.load(std::memory_order_relaxed); }
+    int64_t fetch_queue_messages() const { return fetch_queue_messages_.load(std::memory_order_relaxed); }
+    int64_t max_broker_rtt_us() const { return max_broker_rtt_us_.load(std::memory_order_relaxed); }
+    uint64_t updates() const { return updates_.load(std::memory_order_relaxed); }
+
+    KafkaStatistics(const KafkaStatistics&) = delete;
+    KafkaStatistics& operator=(const KafkaStatistics&) = delete;
+
+private:
+    const bool keep_partitions_;
+
+    mutable std::mutex mutex_;                              /* Guards snapshot_ (pointer swap only). */
+    std::shared_ptr<const KafkaStatsSnapshot> snapshot_;
+
+    std::atomic<int64_t> total_consumer_lag_;
+    std::atomic<int64_t> max_consumer_lag_;
+    std::atomic<int64_t> fetch_queue_messages_;
+    std::atomic<int64_t> max_broker_rtt_us_;
+    std::atomic<uint64_t> updates_;
+};
+
+#endif /* KAFKA_STATISTICS_HPP_ */
@@ -0,0 +1,284 @@
+/**
+ * @file    LatencyHistogram.hpp
+ * @brief   Log-bucketed latency histograms recorded per thread, merged for reporting
+ *
+ * Developer: Equix Technologies
+ * Copyright: Equix Technologies Pty Ltd
+ * Created: June 2025
+ *
+ * Description:
+ *   HDR-style histogram: values below 16 are counted exactly; above that each
+ *   power of two is split into 16 linear sub-buckets, so any recorded value is
+ *   reported within 6.25% using a fixed ~5 KB of counters and no allocation.
+ *   Each histogram has a single writer; readers may merge it concurrently.
+ *   StageLatencyRecorder and PartitionLatencyRecorder give every worker thread
+ *   its own set of histograms, so recording never contends across threads.
+ */
+
+#pragma once
+
+#ifndef LATENCY_HISTOGRAM_HPP_
+#define LATENCY_HISTOGRAM_HPP_
+
+#include "ThreadShards.hpp"
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+namespace market_depth {
+
+/**
+ * @brief Monotonic clock in nanoseconds, for latency measurement
+ */
+inline uint64_t latency_now_ns() {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+/**
+ * @brief Wall clock in microseconds since the epoch, comparable with Kafka message timestamps
+ */
+inline uint64_t latency_wall_clock_us() {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count());
+}
+
+/**
+ * @brief Nanoseconds from from_us to to_us (wall clock, microseconds); 0 if the clocks disagree
+ */
+inline uint64_t wall_latency_ns(uint64_t from_us, uint64_t to_us) {
+    return to_us > from_us ? (to_us - from_us) * 1000 : 0;
+}
+
+/**
+ * @brief Single-writer log-linear histogram of nanosecond latencies
+ */
+class LatencyHistogram {
+public:
+    static constexpr uint32_t kSubBucketBits = 4;
+    static constexpr uint32_t kSubBuckets = 1u << kSubBucketBits;
+    static constexpr uint32_t kMaxExponent = 40;   // ~18 minutes in ns; larger values land in the last bucket
+    static constexpr uint32_t kBucketCount = (kMaxExponent - kSubBucketBits + 1) * kSubBuckets;
+
+    /**
+     * @brief Record one value (writer thread only)
+     */
+    void record(uint64_t value) {
+        const uint32_t index = bucket_index(value);
+        counts_[index].store(counts_[index].load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        count_.store(count_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        sum_.store(sum_.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+        if (value > max_.load(std::memory_order_relaxed)) {
+            max_.store(value, std::memory_order_relaxed);
+        }
+    }
+
+    uint64_t count() const { return count_.load(std::memory_order_relaxed); }
+    uint64_t sum() const { return sum_.load(std::memory_order_relaxed); }
+    uint64_t max() const { return max_.load(std::memory_order_relaxed); }
+    uint64_t bucket_count(uint32_t index) const { return counts_[index].load(std::memory_order_relaxed); }
+
+    static uint32_t bucket_index(uint64_t value) {
+        constexpr uint64_t kLargest = (uint64_t(1) << kMaxExponent) - 1;
+        value = std::min(value, kLargest);
+        if (value < kSubBuckets) {
+            return static_cast<uint32_t>(value);
+        }
+        const uint32_t exponent = 63u - static_cast<uint32_t>(__builtin_clzll(value));
+        const uint32_t sub = static_cast<uint32_t>(value >> (exponent - kSubBucketBits)) & (kSubBuckets - 1);
+        return (exponent - kSubBucketBits + 1) * kSubBuckets + sub;
+    }
+
+    /**
+     * @brief Largest value that maps to bucket index
+     */
+    static uint64_t bucket_upper_bound(uint32_t index) {
+        if (index < kSubBuckets) {
+            return index;
+        }
+        const uint32_t shift = index / kSubBuckets - 1;
+        const uint64_t lower = uint64_t(kSubBuckets + index % kSubBuckets) << shift;
+        return lower + (uint64_t(1) << shift) - 1;
+    }
+
+private:
+    std::array<std::atomic<uint64_t>, kBucketCount> counts_{};
+    std::atomic<uint64_t> count_{0};
+    std::atomic<uint64_t> sum_{0};
+    std::atomic<uint64_t> max_{0};
+};
+
+/**
+ * @brief Plain (non-atomic) merge of one or more histograms, for percentile queries
+ */
+class LatencyDistribution {
+public:
+    void add(const LatencyHistogram& histogram) {
+        for (uint32_t i = 0; i < LatencyHistogram::kBucketCount; ++i) {
+            counts_[i] += histogram.bucket_count(i);
+        }
+        count_ += histogram.count();
+        sum_ += histogram.sum();
+        max_ = std::max(max_, histogram.max());
+    }
+
+    uint64_t count() const { return count_; }
+    uint64_t sum() const { return sum_; }
+    uint64_t max() const { return max_; }
+
+    /**
+     * @brief Value at quantile q in [0, 1] (bucket upper bound, never above max())
+     */
+    uint64_t percentile(double q) const {
+        if (count_ == 0) return 0;
+        const auto rank = std::max<uint64_t>(1, static_cast<uint64_t>(q * static_cast<double>(count_) + 0.5));
+        uint64_t seen = 0;
+        for (uint32_t i = 0; i < LatencyHistogram::kBucketCount; ++i) {
+            seen += counts_[i];
+            if (seen >= rank) {
+                return std::min(LatencyHistogram::bucket_upper_bound(i), max_);
+            }
+        }
+        return max_;
+    }
+
+private:
+    std::array<uint64_t, LatencyHistogram::kBucketCount> counts_{};
+    uint64_t count_ = 0;
+    uint64_t sum_ = 0;
+    uint64_t max_ = 0;
+};
+
+/**
+ * @brief Pipeline stages timed by the processor
+ */
+enum class LatencyStage : uint8_t {
+    Decode,    // Envelope access and dispatch
+    Convert,   // FlatBuffers snapshot or live book -> price ladders
+    Render,    // One depth view -> JSON
+    Produce,   // Enqueue into the producer
+    Message,   // Whole message, end to end through the processor
+    Count
+};
+
+constexpr size_t kLatencyStageCount = static_cast<size_t>(LatencyStage::Count);
+
+inline const char* latency_stage_name(LatencyStage stage) {
+    switch (stage) {
+        case LatencyStage::Decode: return "decode";
+        case LatencyStage::Convert: return "convert";
+        case LatencyStage::Render: return "render";
+        case LatencyStage::Produce: return "produce";
+        case LatencyStage::Message: return "message";
+        default: return "unknown";
+    }
+}
+
+/**
+ * @brief Per-thread stage histograms: each recording thread writes only its own shard
+ *
+ * Shards are created on a thread's first record() and kept for the recorder's
+ * lifetime, so samples from finished threads still count.
+ */
+class StageLatencyRecorder {
+public:
+    void record(LatencyStage stage, uint64_t nanoseconds) {
+        shards_.local().stages[static_cast<size_t>(stage)].record(nanoseconds);
+    }
+
+    /**
+     * @brief Merge every thread's histogram of one stage
+     */
+    LatencyDistribution collect(LatencyStage stage) const {
+        LatencyDistribution distribution;
+        shards_.for_each([&](const Shard& shard) {
+            distribution.add(shard.stages[static_cast<size_t>(stage)]);
+        });
+        return distribution;
+    }
+
+    /**
+     * @brief Threads that have recorded
+     */
+    size_t thread_count() const { return shards_.size(); }
+
+private:
+    struct Shard {
+        LatencyHistogram stages[kLatencyStageCount];
+    };
+
+    ThreadShards<Shard> shards_;
+};
+
+/**
+ * @brief Per-thread histograms keyed by Kafka partition
+ *
+ * A thread's histogram for a partition is allocated on its first record() for
+ * that partition. Partitions outside [0, kMaxPartitions) are not recorded.
+ */
+class PartitionLatencyRecorder {
+public:
+    static constexpr int32_t kMaxPartitions = 256;
+
+    void record(int32_t partition, uint64_t nanoseconds) {
+        if (partition < 0 || partition >= kMaxPartitions) return;
+
+        auto &slot = shards_.local().partitions[static_cast<size_t>(partition)];
+        LatencyHistogram *histogram = slot.load(std::memory_order_relaxed);
+        if (!histogram) {
+            histogram = new LatencyHistogram();
+            slot.store(histogram, std::memory_order_release);
+
+            int32_t limit = partition_limit_.load(std::memory_order_relaxed);
+            while (partition >= limit &&
+                   !partition_limit_.compare_exchange_weak(limit, partition + 1, std::memory_order_relaxed)) {
+            }
+        }
+        histogram->record(nanoseconds);
+    }
+
+    /**
+     * @brief One past the highest partition recorded so far
+     */
+    int32_t partition_limit() const { return partition_limit_.load(std::memory_order_relaxed); }
+
+    /**
+     * @brief Merge every thread's histogram of one partition
+     */
+    LatencyDistribution collect(int32_t partition) const {
+        LatencyDistribution distribution;
+        if (partition < 0 || partition >= kMaxPartitions) return distribution;
+
+        shards_.for_each([&](const Shard &shard) {
+            const LatencyHistogram *histogram =
+                shard.partitions[static_cast<size_t>(partition)].load(std::memory_order_acquire);
+            if (histogram) distribution.add(*histogram);
+        });
+        return distribution;
+    }
+
+    /**
+     * @brief Threads that have recorded
+     */
+    size_t thread_count() const { return shards_.size(); }
+
+private:
+    struct Shard {
+        std::array<std::atomic<LatencyHistogram *>, kMaxPartitions> partitions{};
+
+        ~Shard() {
+            for (auto &slot : partitions) {
+                delete slot.load(std::memory_order_relaxed);
+            }
+        }
+    };
+
+    std::atomic<int32_t> partition_limit_{0};
+    ThreadShards<Shard> shards_;
+};
+
+} // namespace market_depth
+
+#endif /* LATENCY_HISTOGRAM_HPP_ */
@@ -0,0 +1,157 @@
+/**
+ * @file    LogThrottle.hpp
+ * @brief   Rate-limited and sampled logging macros for hot paths
+ *
+ * Developer: Equix Technologies
+ * Copyright: Equix Technologies Pty Ltd
+ * Created: June 2025
+ *
+ * Description:
+ *   Thin layer over the bundled spdlog. Each macro call site owns a static
+ *   limiter, so a single noisy site cannot flood the log:
+ *     - MD_<LEVEL>_RATE_LIMITED(n, ...)  emits at most n lines per second and
+ *       reports how many lines were suppressed when output resumes.
+ *     - MD_<LEVEL>_SAMPLED(k, ...)       emits 1 in every k calls.
+ *   The level check and the limiter run before any argument is formatted, so
+ *   a suppressed call costs a few relaxed atomics and no formatting work.
+ *   Levels compiled out through SPDLOG_ACTIVE_LEVEL compile to (void)0.
+ */
+
+#pragma once
+
+#ifndef LOG_THROTTLE_HPP_
+#define LOG_THROTTLE_HPP_
+
+#include "spdlog/spdlog.h"
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+namespace market_depth {
+namespace logging {
+
+/**
+ * @brief Per-call-site limiter: at most max_per_second messages per one-second window
+ */
+class RateLimiter {
+public:
+    explicit RateLimiter(uint32_t max_per_second)
+        : max_per_second_(max_per_second), window_start_ns_(0), count_(0), suppressed_(0) {}
+
+    /**
+     * @brief Returns true if the caller may log now
+     * @param suppressed Receives the number of calls suppressed since the last allowed one
+     */
+    bool allow(uint64_t& suppressed) {
+        const int64_t now_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+
+        int64_t window_start = window_start_ns_.load(std::memory_order_relaxed);
+        if (now_ns - window_start >= kWindowNs &&
+            window_start_ns_.compare_exchange_strong(window_start, now_ns, std::memory_order_relaxed)) {
+            count_.store(0, std::memory_order_relaxed);
+        }
+
+        if (count_.fetch_add(1, std::memory_order_relaxed) < max_per_second_) {
+            suppressed = suppressed_.exchange(0, std::memory_order_relaxed);
+            return true;
+        }
+
+        suppressed_.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+
+private:
+    static constexpr int64_t kWindowNs = 1000000000;
+
+    const uint32_t max_per_second_;
+    std::atomic<int64_t> window_start_ns_;
+    std::atomic<uint32_t> count_;
+    std::atomic<uint64_t> suppressed_;
+};
+
+/**
+ * @brief Per-call-site sampler: lets through 1 in every_n calls (the first one included)
+ */
+class Sampler {
+public:
+    explicit Sampler(uint32_t every_n) : every_n_(every_n > 0 ? every_n : 1), calls_(0) {}
+
+    bool allow() {
+        return calls_.fetch_add(1, std::memory_order_relaxed) % every_n_ == 0;
+    }
+
+private:
+    const uint64_t every_n_;
+    std::atomic<uint64_t> calls_;
+};
+
+} // namespace logging
+} // namespace market_depth
+
+#define MD_LOG_RATE_LIMITED(level, max_per_second, ...)                                         \
+    do {                                                                                        \
+        if (spdlog::default_logger_raw()->should_log(level)) {                                  \
+            static ::market_depth::logging::RateLimiter md_rate_limiter_{max_per_second};       \
+            uint64_t md_suppressed_ = 0;                                                        \
+            if (md_rate_limiter_.allow(md_suppressed_)) {                                       \
+                if (md_suppressed_ > 0) {                                                       \
+                    SPDLOG_LOGGER_CALL(spdlog::default_logger_raw(), level,                     \
+                                       "{} similar messages suppressed", md_suppressed_);       \
+                }                                                                               \
+                SPDLOG_LOGGER_CALL(spdlog::default_logger_raw(), level, __VA_ARGS__);           \
+            }                                                                                   \
+        }                                                                                       \
+    } while (0)
+
+#define MD_LOG_SAMPLED(level, every_n, ...)                                                     \
+    do {                                                                                        \
+        if (spdlog::default_logger_raw()->should_log(level)) {                                  \
+            static ::market_depth::logging::Sampler md_sampler_{every_n};                       \
+            if (md_sampler_.allow()) {                                                          \
+                SPDLOG_LOGGER_CALL(spdlog::default_logger_raw(), level, __VA_ARGS__);           \
+            }                                                                                   \
+        }                                                                                       \
+    } while (0)
+
+#if SPDLOG_ACTIVE_LEVEL <= SPDLOG_LEVEL_TRACE
+    #define MD_TRACE_RATE_LIMITED(n, ...) MD_LOG_RATE_LIMITED(spdlog::level::trace, n, __VA_ARGS__)
+    #define MD_TRACE_SAMPLED(k, ...) MD_LOG_SAMPLED(spdlog::level::trace, k, __VA_ARGS__)
+#else
+    #define MD_TRACE_RATE_LIMITED(n, ...) (void)0
+    #define MD_TRACE_SAMPLED(k, ...) (void)0
+#endif
+
+#if SPDLOG_ACTIVE_LEVEL <= SPDLOG_LEVEL_DEBUG
+    #define MD_DEBUG_RATE_LIMITED(n, ...) MD_LOG_RATE_LIMITED(spdlog::level::debug, n, __VA_ARGS__)
+    #define MD_DEBUG_SAMPLED(k, ...) MD_LOG_SAMPLED(spdlog::level::debug, k, __VA_ARGS__)
+#else
+    #define MD_DEBUG_RATE_LIMITED(n, ...) (void)0
+    #define MD_DEBUG_SAMPLED(k, ...) (void)0
+#endif
+
+#if SPDLOG_ACTIVE_LEVEL <= SPDLOG_LEVEL_INFO
+    #define MD_INFO_RATE_LIMITED(n, ...) MD_LOG_RATE_LIMITED(spdlog::level::info, n, __VA_ARGS__)
+    #define MD_INFO_SAMPLED(k, ...) MD_LOG_SAMPLED(spdlog::level::info, k, __VA_ARGS__)
+#else
+    #define MD_INFO_RATE_LIMITED(n, ...) (void)0
+    #define MD_INFO_SAMPLED(k, ...) (void)0
+#endif
+
+#if SPDLOG_ACTIVE_LEVEL <= SPDLOG_LEVEL_WARN
+    #define MD_WARN_RATE_LIMITED(n, ...) MD_LOG_RATE_LIMITED(spdlog::level::warn, n, __VA_ARGS__)
+    #define MD_WARN_SAMPLED(k, ...) MD_LOG_SAMPLED(spdlog::level::warn, k, __VA_ARGS__)
+#else
+    #define MD_WARN_RATE_LIMITED(n, ...) (void)0
+    #define MD_WARN_SAMPLED(k, ...) (void)0
+#endif
+
+#if SPDLOG_ACTIVE_LEVEL <= SPDLOG_LEVEL_ERROR
+    #define MD_ERROR_RATE_LIMITED(n, ...) MD_LOG_RATE_LIMITED(spdlog::level::err, n, __VA_ARGS__)
+    #define MD_ERROR_SAMPLED(k, ...) MD_LOG_SAMPLED(spdlog::level::err, k, __VA_ARGS__)
+#else
+    #define MD_ERROR_RATE_LIMITED(n, ...) (void)0
+    #define MD_ERROR_SAMPLED(k, ...) (void)0
+#endif
+
+#endif /* LOG_THROTTLE_HPP_ */
@@ -1,14 +1,16 @@
 /**
  * @file    MarketDepthProcessor.hpp
- * @brief   Simplified market depth processing engine - direct snapshot processing
+ * @brief   Market depth processing engine - snapshots and L3 delta batches to multi-depth views
  *
  * Developer: Equix Technologies
  * Copyright: Equix Technologies Pty Ltd
  * Created: June 2025
  *
  * Description:
- *   Simplified processing engine that consumes FlatBuffers snapshots directly
- *   and publishes multi-depth JSON messages without maintaining order book state.
+ *   Processing engine that consumes FlatBuffers envelopes and publishes
+ *   multi-depth messages per symbol. Snapshots are rendered directly; with
+ *   delta processing enabled, live L3 order books are seeded from snapshots,
+ *   kept current by sequenced DeltaBatches and rendered after each change.
  *   Designed for real-time processing with 8-partition consumption.
  */
 
@@ -18,9 +20,16 @@
 #define MARKET_DEPTH_PROCESSOR_HPP_
 
 #include "MessageFactory.hpp"
+#include "OrderBook.hpp"
+#include "SymbolTable.hpp"
+#include "SymbolHeavyHitters.hpp"
 #include "KafkaConsumer.hpp"
 #include "KafkaProducer.hpp"
 #include "KafkaPush.hpp"
+#include "FlightRecorder.hpp"
+#include "LatencyHistogram.hpp"
+#include "MetricsServer.hpp"
+#include "ThreadShards.hpp"
 #include "orderbook_generated.h"
 #include <thread>
 #include <atomic>
@@ -28,6 +37,8 @@
 #include <memory>
 #include <vector>
 #include <unordered_map>
+#include <unordered_set>
+#include <string_view>
 #include <mutex>
 
 namespace market_depth {
@@ -35,6 +46,14 @@ namespace market_depth {
 // Forward declare FlatBuffers types
 namespace fb = ::md;
 
+/**
+ * @brief How raw FlatBuffers payloads from an input topic are checked before use
+ */
+enum class InputVerification : uint8_t {
+    Trusted,   // Read in place with no checks (internal feeds)
+    Verified   // Run the FlatBuffers verifier first; malformed payloads are rejected
+};
+
 /**
  * @brief Simplified configuration for the market depth processor
  */
@@ -44,9 +63,24 @@ struct ProcessorConfig {
     std::string input_topic;
     int consumer_poll_timeout_ms;
     int num_partitions;  // Number of partitions to consume (8)
+    bool enable_partition_workers;  // One worker thread per partition queue
+    bool enable_delta_processing;   // Maintain live books and apply DeltaBatch messages
+    // Input verification: per-topic mode, default for unlisted topics, verifier limits
+    InputVerification default_verification;
+    std::unordered_map<std::string, InputVerification> topic_verification;
+    uint32_t verifier_max_depth;
+    uint32_t verifier_max_tables;
+
+    bool enable_conflation;         // Drop snapshots superseded by a newer one for the same symbol in the batch
+    uint32_t catchup_publish_interval_ms;  // While catching up, publish the latest book per symbol this often
+    double backpressure_high_watermark;  // Pause input when the producer queue is this full (0-1)
+    double backpressure_low_watermark;   // Resume input once it drains back to this level (0-1)
 
     // Depth configuration
     std::vector<uint32_t> depth_levels;
+    uint32_t max_price_levels;  // Per-side ladder capacity
+    bool suppress_unchanged_depths;  // Skip a depth view whose top levels are unchanged since last published
+    uint32_t depth_heartbeat_ms;     // Republish an unchanged view after this long (0 = never)
 
     // Message factory configuration
     MessageFactory::JsonConfig json_config;
@@ -55,9 +89,15 @@ struct ProcessorConfig {
     MessageRouter::TopicConfig topic_config;
 
     // Processing configuration
-    uint32_t flush_interval_ms;
     bool enable_statistics;
     uint32_t stats_report_interval_s;
+    uint32_t top_symbols_capacity;  // Symbols tracked per processing thread for the top-symbols report
+
+    // Monitoring
+    bool enable_metrics_endpoint;  // Serve Prometheus metrics over HTTP
+    uint16_t metrics_port;
+    uint32_t slow_message_threshold_us;  // Record messages slower than this in the flight recorder (0 = off)
+    uint32_t flight_recorder_size;       // Slow messages retained
 
     ProcessorConfig();
 };
@@ -71,13 +111,19 @@ struct PerformanceMetrics {
     std::atomic<uint64_t> messages_published{0};
     std::atomic<uint64_t> processing_errors{0};
     std::atomic<uint64_t> kafka_errors{0};
-
-    std::atomic<uint64_t> total_processing_time_us{0};
-    std::atomic<uint64_t> max_processing_time_us{0};
-    std::atomic<uint64_t> min_processing_time_us{UINT64_MAX};
-
-    // Per-symbol metrics
-    std::unordered_map<std::string, std::atomic<uint64_t>> symbol_message_counts;
+    std::atomic<uint64_t> deltas_applied{0};
+    std::atomic<uint64_t> delta_batches_dropped{0};   // Held while a symbol is unseeded or stale
+    std::atomic<uint64_t> duplicates_dropped{0};
+    std::atomic<uint64_t> sequence_gaps{0};
+    std::atomic<uint64_t> stale_symbols{0};           // Gauge: symbols waiting for a re-seeding snapshot
+    std::atomic<uint64_t> input_pauses{0};            // Times input was paused for producer backpressure
+    std::atomic<uint64_t> messages_conflated{0};      // Superseded before any conversion or rendering
+    std::atomic<uint64_t> catchup_batches{0};         // Batches consumed while a partition was catching up
+    std::atomic<uint64_t> catchup_superseded{0};      // Snapshots replaced in the catch-up window before rendering
+    std::atomic<uint64_t> depth_views_suppressed{0};  // Unchanged depth views not rendered or published
+    std::atomic<uint64_t> messages_verified{0};
+    std::atomic<uint64_t> messages_rejected{0};       // Failed FlatBuffers verification
+    std::atomic<uint64_t> verify_time_us{0};          // Total time spent in the verifier
 
     // Timing
     std::chrono::high_resolution_clock::time_point start_time;
@@ -90,12 +136,21 @@ struct PerformanceMetrics {
         , messages_published(other.messages_published.load())
         , processing_errors(other.processing_errors.load())
         , kafka_errors(other.kafka_errors.load())
-        , total_processing_time_us(other.total_processing_time_us.load())
-        , max_processing_time_us(other.max_processing_time_us.load())
-        , min_processing_time_us(other.min_processing_time_us.load())
+        , deltas_applied(other.deltas_applied.load())
+        , delta_batches_dropped(other.delta_batches_dropped.load())
+        , duplicates_dropped(other.duplicates_dropped.load())
+        , sequence_gaps(other.sequence_gaps.load())
+        , stale_symbols(other.stale_symbols.load())
+        , input_pauses(other.input_pauses.load())
+        , messages_conflated(other.messages_conflated.load())
+        , catchup_batches(other.catchup_batches.load())
+        , catchup_superseded(other.catchup_superseded.load())
+        , depth_views_suppressed(other.depth_views_suppressed.load())
+        , messages_verified(other.messages_verified.load())
+        , messages_rejected(other.messages_rejected.load())
+        , verify_time_us(other.verify_time_us.load())
         , start_time(other.start_time)
         , last_stats_time(other.last_stats_time) {
-        // Note: symbol_message_counts copying is complex with atomics, skip for now
     }
 
     // Assignment operator
@@ -106,9 +161,19 @@ struct PerformanceMetrics {
             messages_published = other.messages_published.load();
             processing_errors = other.processing_errors.load();
             kafka_errors = other.kafka_errors.load();
-            total_processing_time_us = other.total_processing_time_us.load();
-            max_processing_time_us = other.max_processing_time_us.load();
-            min_processing_time_us = other.min_processing_time_us.load();
+            deltas_applied = other.deltas_applied.load();
+            delta_batches_dropped = other.delta_batches_dropped.load();
+            duplicates_dropped = other.duplicates_dropped.load();
+            sequence_gaps = other.sequence_gaps.load();
+            stale_symbols = other.stale_symbols.load();
+            input_pauses = other.input_pauses.load();
+            messages_conflated = other.messages_conflated.load();
+            catchup_batches = other.catchup_batches.load();
+            catchup_superseded = other.catchup_superseded.load();
+            depth_views_suppressed = other.depth_views_suppressed.load();
+            messages_verified = other.messages_verified.load();
+            messages_rejected = other.messages_rejected.load();
+            verify_time_us = other.verify_time_us.load();
             start_time = other.start_time;
             last_stats_time = other.last_stats_time;
         }
@@ -124,23 +189,22 @@ struct PerformanceMetrics {
         messages_published = 0;
         processing_errors = 0;
         kafka_errors = 0;
-        total_processing_time_us = 0;
-        max_processing_time_us = 0;
-        min_processing_time_us = UINT64_MAX;
-        symbol_message_counts.clear();
+        deltas_applied = 0;
+        delta_batches_dropped = 0;
+        duplicates_dropped = 0;
+        sequence_gaps = 0;
+        stale_symbols = 0;
+        input_pauses = 0;
+        messages_conflated = 0;
+        catchup_batches = 0;
+        catchup_superseded = 0;
+        depth_views_suppressed = 0;
+        messages_verified = 0;
+        messages_rejected = 0;
+        verify_time_us = 0;
         start_time = std::chrono::high_resolution_clock::now();
         last_stats_time = start_time;
     }
-
-    void update_processing_time(uint64_t time_us) {
-        total_processing_time_us += time_us;
-
-        uint64_t current_max = max_processing_time_us.load();
-        while (time_us > current_max && !max_processing_time_us.compare_exchange_weak(current_max, time_us));
-
-        uint64_t current_min = min_processing_time_us.load();
-        while (time_us < current_min && !min_processing_time_us.compare_exchange_weak(current_min, time_us));
-    }
 };
 
 /**
@@ -177,6 +241,24 @@ public:
      */
     void print_statistics() const;
 
+    /**
+     * @brief Append all metrics in Prometheus text exposition format
+     *
+     * Only relaxed loads and the per-stage histogram merge; safe to call from
+     * the metrics server thread while processing runs.
+     */
+    void write_prometheus_metrics(std::string& out) const;
+
+    /**
+     * @brief Log every slow message retained by the flight recorder, oldest first
+     */
+    void dump_flight_recorder() const;
+
+    /**
+     * @brief Ask the processing loop to dump the flight recorder (async-signal-safe)
+     */
+    void request_flight_recorder_dump() { flight_dump_requested_.store(true, std::memory_order_relaxed); }
+
     /**
      * @brief Check if processor is running
      */
@@ -184,10 +266,190 @@ public:
 
 private:
     /**
-     * @brief Main processing loop for a specific partition
+     * @brief Main processing loop on the consumer queue (also serves rebalances)
      */
     void processing_loop();
 
+    /**
+     * @brief Worker loop for one partition queue
+     * @param queue_index Worker queue index (owns partitions p with p % num_partitions == queue_index)
+     */
+    void partition_worker_loop(size_t queue_index);
+
+    /**
+     * @brief Pause or resume the input partitions from the producer queue fill level
+     *
+     * Pauses at the high watermark (or while messages are parked for retry) and
+     * resumes at the low watermark, so a slow output cluster throttles consumption
+     * instead of dropping output.
+     */
+    void apply_backpressure();
+
+    /**
+     * @brief Process, account and destroy a batch of consumed Kafka messages
+     *
+     * Metrics are published once per batch rather than once per message.
+     */
+    void handle_batch(rd_kafka_message_t** messages, size_t count);
+
+    /**
+     * @brief Per-message disposition decided before a batch is processed
+     */
+    enum BatchDrop : uint8_t {
+        kKeep = 0,
+        kRejected,    // Failed verification: never parsed
+        kSuperseded   // Conflated away by a later snapshot of the same symbol
+    };
+
+    /**
+     * @brief Verify the payloads of messages from Verified topics, marking failures kRejected
+     * @return Number of messages rejected
+     */
+    size_t verify_batch(rd_kafka_message_t** messages, size_t count, std::vector<uint8_t>& drop);
+
+    /**
+     * @brief Verification mode for a message's topic
+     */
+    InputVerification verification_mode(const rd_kafka_topic_t* rkt) const;
+
+    /**
+     * @brief Mark the messages of a batch that a later snapshot of the same symbol supersedes
+     *
+     * Walks the batch newest-first: once a symbol's newest snapshot is found, every
+     * earlier snapshot or delta batch for that symbol is covered by it and is marked
+     * kSuperseded in drop, so only the latest book is converted and rendered.
+     * Messages already marked are skipped.
+     * @param only If set, only messages with a catch-up window there are considered
+     * @return Number of messages marked
+     */
+    struct CatchUpWindow;
+    size_t conflate_batch(rd_kafka_message_t** messages, size_t count, std::vector<uint8_t>& drop,
+                          const std::vector<CatchUpWindow*>* only = nullptr) const;
+
+    /**
+     * @brief Where the input message currently being processed came from
+     *
+     * Set per message by handle_batch and copied into every snapshot built from
+     * it, so published output can be timed against the input Kafka timestamp.
+     */
+    struct IngestContext {
+        uint64_t timestamp_us = 0;  // Input Kafka message timestamp (0 = not available)
+        int32_t partition = -1;
+    };
+
+    /**
+     * @brief Calling thread's ingest context
+     */
+    IngestContext& ingest_context() const;
+
+    /**
+     * @brief What the message currently being processed cost, for the flight recorder
+     */
+    struct MessageTrace {
+        uint64_t stage_ns[kLatencyStageCount] = {};
+        SymbolId symbol = kInvalidSymbolId;
+        uint32_t bid_levels = 0;
+        uint32_t ask_levels = 0;
+        uint32_t views_published = 0;
+    };
+
+    /**
+     * @brief Calling thread's message trace, reset by handle_batch before each message
+     */
+    MessageTrace& message_trace() const;
+
+    /**
+     * @brief Record a stage timing in the latency histograms and the current message trace
+     */
+    void record_stage(LatencyStage stage, uint64_t nanoseconds);
+
+    /**
+     * @brief Store msg and its trace in the flight recorder
+     */
+    void record_slow_message(const rd_kafka_message_t* msg, uint64_t total_ns);
+
+    struct ParkedSnapshot {
+        std::string payload;  // Snapshot envelope
+        IngestContext ingest;
+    };
+
+    /**
+     * @brief Catch-up state of one input partition: the newest pending output per symbol
+     *
+     * While the partition lags beyond the consumer's catchup_lag_threshold, its
+     * snapshots are parked here (raw payload, newest per symbol) and the live books
+     * it updates are only marked dirty. Every catchup_publish_interval_ms, and once
+     * the partition's lag is back under the threshold, each symbol is rendered and
+     * published once. Symbols are keyed to one partition, so windows never overlap.
+     */
+    struct CatchUpWindow {
+        bool active = false;
+        bool lagging = false;  // Lag at the partition's last check
+        std::chrono::steady_clock::time_point opened;
+        std::unordered_map<SymbolId, ParkedSnapshot> parked;     // Newest snapshot per symbol
+        std::unordered_map<SymbolId, IngestContext> dirty_books; // Ingest of the newest update per book
+    };
+
+    struct PartitionKey {
+        const rd_kafka_topic_t* rkt;
+        int32_t partition;
+        bool operator==(const PartitionKey& other) const { return rkt == other.rkt && partition == other.partition; }
+    };
+
+    struct PartitionKeyHash {
+        size_t operator()(const PartitionKey& key) const {
+            return std::hash<const void*>()(key.rkt) ^ (static_cast<size_t>(key.partition) * 0x9e3779b97f4a7c15ULL);
+        }
+    };
+
+    /**
+     * @brief One thread's catch-up windows, for the partitions that thread consumes
+     */
+    struct CatchUpState {
+        std::unordered_map<PartitionKey, CatchUpWindow, PartitionKeyHash> windows;
+        CatchUpWindow* current = nullptr;  // Open window of the message being processed, if any
+    };
+
+    /**
+     * @brief Check the lag of every partition in the batch and open or keep their windows
+     * @param window_of Set to each message's open window, or nullptr where output is not held back
+     * @return true if any partition in the batch is lagging
+     */
+    bool update_catchup_windows(CatchUpState& state, rd_kafka_message_t** messages, size_t count,
+                                std::vector<CatchUpWindow*>& window_of);
+
+    /**
+     * @brief Park a snapshot message in its partition's catch-up window
+     * @return false if msg is not a snapshot (it is then processed normally)
+     */
+    bool park_snapshot(const rd_kafka_message_t* msg, CatchUpWindow& window);
+
+    /**
+     * @brief Publish everything held in a catch-up window and close it
+     */
+    void flush_catchup_window(CatchUpWindow& window);
+
+    /**
+     * @brief Flush and forget every catch-up window of the calling thread
+     */
+    void flush_catchup_windows();
+
+    /**
+     * @brief Publish a live book now, or defer it while its partition's catch-up window is open
+     */
+    void publish_book_or_defer(const OrderBook& book, SymbolId id);
+
+    /**
+     * @brief Intern a FlatBuffers symbol string
+     * @return kInvalidSymbolId if the symbol table is full
+     */
+    SymbolId intern_symbol(const ::flatbuffers::String* symbol);
+
+    /**
+     * @brief The symbol's live book, created on first use (delta processing only)
+     */
+    OrderBook& book_for(SymbolState& state);
+
     /**
      * @brief Process a single Kafka message
      */
@@ -198,10 +460,34 @@ private:
      */
     bool process_snapshot(const fb::OrderBookSnapshot* snapshot);
 
+    /**
+     * @brief Apply a DeltaBatch to the symbol's live book and publish its depth views
+     */
+    bool process_delta_batch(const fb::DeltaBatch* batch);
+
     /**
      * @brief Publish snapshot messages for all depth levels
      */
-    void publish_snapshots(const std::string& symbol, const fb::OrderBookSnapshot* snapshot);
+    void publish_snapshots(SymbolState& state, const fb::OrderBookSnapshot* snapshot);
+
+    /**
+     * @brief Publish all configured depth views of a live book
+     */
+    void publish_book(const OrderBook& book, SymbolState& state);
+
+    /**
+     * @brief Publish every configured depth view of a converted snapshot
+     */
+    void publish_depths(const InternalOrderBookSnapshot& snapshot, SymbolState& state);
+
+    /**
+     * @brief Render and publish the top-depth view of a snapshot
+     *
+     * Skipped if too shallow, or if its fingerprint matches the last published
+     * view_index view and the heartbeat interval has not elapsed.
+     */
+    void publish_depth(const InternalOrderBookSnapshot& snapshot, uint32_t depth, SymbolState& state,
+                       size_t view_index);
 
     /**
      * @brief Statistics reporting thread
@@ -213,6 +499,11 @@ private:
      */
     PriceLevel convert_price_level(const fb::OrderMsgLevel* fb_level) const;
 
+    /**
+     * @brief Calling thread's reusable snapshot, cleared and sized to max_price_levels
+     */
+    InternalOrderBookSnapshot& scratch_snapshot() const;
+
     /**
      * @brief Get current timestamp in microseconds
      */
@@ -223,23 +514,32 @@ private:
 
 private:
     ProcessorConfig config_;
+    uint32_t max_depth_;  // Deepest configured depth level, capped at max_price_levels
 
     // Core components
     std::unique_ptr<MessageFactory> message_factory_;
     std::unique_ptr<MessageRouter> message_router_;
+    std::unique_ptr<OrderBookManager> order_books_;  // Only when delta processing is enabled
+    std::unique_ptr<SymbolTable> symbols_;           // Interned symbols and their per-symbol output state
+    std::unique_ptr<SymbolHeavyHitters> top_symbols_;  // Per-thread message counts of the heaviest symbols
 
     // Threading and control
     std::atomic<bool> running_;
     std::atomic<bool> should_stop_;
     std::thread processing_thread_;
     std::thread stats_thread_;
+    std::unique_ptr<MetricsServer> metrics_server_;
+    std::vector<std::thread> worker_threads_;
 
     // Performance metrics
     mutable std::mutex metrics_mutex_;
     PerformanceMetrics metrics_;
-
-    // Message batching
-    std::chrono::high_resolution_clock::time_point last_flush_time_;
+    StageLatencyRecorder latency_;                   // Per-thread stage histograms, merged by print_statistics
+    PartitionLatencyRecorder consume_latency_;       // Input Kafka timestamp -> consumed, per input partition
+    PartitionLatencyRecorder enqueue_latency_;       // Input Kafka timestamp -> output enqueued, per input partition
+    std::unique_ptr<FlightRecorder> flight_recorder_;  // Slow messages (only when a threshold is configured)
+    std::atomic<bool> flight_dump_requested_;
+    ThreadShards<CatchUpState> catchup_;             // Per-thread, per-partition catch-up windows
 };
 
 /**
@@ -253,6 +553,7 @@ public:
 private:
     MarketDepthProcessor& processor_;
     static void signal_handler(int signal);
+    static void dump_signal_handler(int signal);
     static ProcessorShutdownHandler* instance_;
 };
 
@@ -18,10 +18,10 @@
 #define MESSAGE_FACTORY_HPP_
 
 #include "OrderBookTypes.hpp"
-#include <nlohmann/json.hpp>
+#include "JsonWriter.hpp"
+#include "ExchangeRegistry.hpp"
 #include <string>
-#include <sstream>
-#include <iomanip>
+#include <string_view>
 #include <map>
 #include <functional>
 
@@ -41,7 +41,7 @@ public:
         bool include_timestamp;
         bool include_sequence;
         bool compact_format;
-        std::string exchange_name;
+        std::string exchange_name;  // Venue of the input feed
 
         JsonConfig();
     };
@@ -50,27 +50,53 @@ public:
     MessageFactory();
 
     std::string create_snapshot_json(const InternalOrderBookSnapshot& snapshot, uint32_t depth) const;
+
+    /**
+     * @brief Append the depth snapshot JSON to out (reuse out across calls to avoid allocation)
+     */
+    void write_snapshot_json(const InternalOrderBookSnapshot& snapshot, uint32_t depth, std::string& out) const;
     std::string create_cdc_json(const CDCEvent& event) const;  // Kept for compatibility but disabled
     std::map<uint32_t, std::string> create_multi_depth_json(
         const InternalOrderBookSnapshot& snapshot,
         const std::vector<uint32_t>& depth_levels) const;
 
-    void update_config(const JsonConfig& config) { config_ = config; }
+    void update_config(const JsonConfig& config);
     const JsonConfig& get_config() const { return config_; }
 
+    /**
+     * @brief Venues known to the output; level ExchangeMasks index into it
+     */
+    const ExchangeRegistry& exchange_registry() const { return exchanges_; }
+
+    /**
+     * @brief Mask of the configured feed exchange (json_config.exchange_name)
+     */
+    ExchangeMask default_exchanges() const { return default_exchanges_; }
+
+    static constexpr uint32_t kMaxFixedPointDecimals = 19;  // 10^19 is the largest power of ten in uint64_t
+    static constexpr size_t kMaxFixedPointChars = 40;
+
+    /**
+     * @brief Render scaled / 10^decimals with exactly `decimals` fraction digits using integer math only
+     * @param out Buffer of at least kMaxFixedPointChars bytes (not NUL-terminated)
+     * @return Number of characters written
+     * @note decimals above kMaxFixedPointDecimals are clamped
+     */
+    static size_t format_fixed_point(uint64_t scaled, uint32_t decimals, char* out);
+
 private:
-    std::string format_price(uint64_t price_scaled) const;
-    std::string format_quantity(uint64_t quantity_scaled) const;
-    nlohmann::json price_level_to_json(const PriceLevel& level, OrderSide side,
-                                      const std::string& symbol) const;
-    void add_common_fields(nlohmann::json& j, const std::string& symbol,
-                          uint64_t sequence, uint64_t timestamp) const;
+    void write_price(JsonWriter& w, std::string_view name, uint64_t price_scaled) const;
+    void write_quantity(JsonWriter& w, std::string_view name, uint64_t quantity_scaled) const;
+    void write_price_level(JsonWriter& w, const PriceLevel& level, OrderSide side,
+                           const std::string& symbol) const;
 
     static std::string side_to_string(OrderSide side);
     static std::string cdc_event_type_to_string(CDCEventType type);
 
 private:
     JsonConfig config_;
+    ExchangeRegistry exchanges_;
+    ExchangeMask default_exchanges_;
 };
 
 /**
@@ -0,0 +1,74 @@
+/**
+ * @file    MetricsServer.hpp
+ * @brief   Minimal HTTP endpoint serving Prometheus text-format metrics
+ *
+ * Developer: Equix Technologies
+ * Copyright: Equix Technologies Pty Ltd
+ * Created: June 2025
+ *
+ * Description:
+ *   One background thread accepts connections on monitoring.metrics_port and
+ *   answers GET /metrics with the body produced by a render callback. The
+ *   callback reads counters with relaxed loads, so a scrape never blocks the
+ *   processing threads. Requests are served one at a time with short socket
+ *   timeouts; this is a scrape target, not a general web server.
+ */
+
+#pragma once
+
+#ifndef METRICS_SERVER_HPP_
+#define METRICS_SERVER_HPP_
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <thread>
+
+namespace market_depth {
+
+/**
+ * @brief Serves GET /metrics on a TCP port from a background thread
+ */
+class MetricsServer {
+public:
+    /**
+     * @brief Appends the full exposition body to the given string
+     */
+    using Renderer = std::function<void(std::string&)>;
+
+    MetricsServer(uint16_t port, Renderer renderer);
+    ~MetricsServer();
+
+    /**
+     * @brief Binds the port and starts the server thread
+     * @return false if the port could not be bound (logged)
+     */
+    bool start();
+
+    /**
+     * @brief Stops the server thread and closes the socket
+     */
+    void stop();
+
+    uint16_t port() const { return port_; }
+
+    MetricsServer(const MetricsServer&) = delete;
+    MetricsServer& operator=(const MetricsServer&) = delete;
+
+private:
+    void serve_loop();
+    void handle_connection(int fd);
+
+    const uint16_t port_;
+    Renderer renderer_;
+    int listen_fd_;
+    std::atomic<bool> running_;
+    std::thread thread_;
+    std::string body_;       // Reused across scrapes (server thread only)
+    std::string response_;
+};
+
+} // namespace market_depth
+
+#endif /* METRICS_SERVER_HPP_ */
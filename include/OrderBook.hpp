@@ -1,15 +1,21 @@
 /**
  * @file    OrderBook.hpp
- * @brief   Order book state management and CDC generation
+ * @brief   Stateful per-symbol order book driven by snapshots and delta batches
  *
  * Developer: Equix Technologies
  * Copyright: Equix Technologies Pty Ltd
  * Created: June 2025
  *
  * Description:
- *   Manages order book state for individual symbols, handles snapshot updates,
- *   and generates CDC events for downstream consumers. Optimized for high-frequency
- *   market data processing with minimal latency and memory allocation.
+ *   Maintains a live order-level (L3) book per symbol. Full OrderBookSnapshot
+ *   messages seed (or re-seed) the book; DeltaBatch messages apply
+ *   Add/Modify/Remove/Trade events on top of it.
+ *
+ *   Orders live in a slot pool and are linked into a FIFO queue per price
+ *   level (time priority). An open-addressing order_id -> slot index finds
+ *   an order in O(1) without per-order heap allocation. Every level keeps its
+ *   aggregate quantity and order count current as orders change, so the L2
+ *   depth views exported as InternalOrderBookSnapshot never walk orders.
  */
 
 #pragma once
@@ -19,9 +25,8 @@
 
 #include "OrderBookTypes.hpp"
 #include "orderbook_generated.h"
-#include <chrono>
-#include <functional>
 #include <memory>
+#include <mutex>
 #include <shared_mutex>
 
 namespace market_depth {
@@ -29,83 +34,243 @@ namespace market_depth {
 // Forward declare FlatBuffers types from generated code
 namespace fb = ::md;
 
+constexpr uint32_t kInvalidSlot = UINT32_MAX;
+
+/**
+ * @brief Resting order slot in the book's order pool
+ *
+ * prev/next link the order into its level's FIFO queue; free slots reuse next
+ * as the free-list link.
+ */
+struct BookOrder {
+    uint64_t order_id;
+    uint64_t price;
+    uint64_t quantity;
+    uint32_t prev;
+    uint32_t next;
+    OrderSide side;
+};
+
+/**
+ * @brief Price level: live L2 aggregate plus the head/tail of its order queue
+ */
+struct BookLevel {
+    PriceLevel aggregate;
+    uint32_t head = kInvalidSlot;
+    uint32_t tail = kInvalidSlot;
+};
+
+/**
+ * @brief Open-addressing order_id -> pool slot map
+ *
+ * Linear probing over a power-of-two table kept at most half full; erase uses
+ * backward-shift deletion so lookups never wade through tombstones.
+ * order_id 0 marks an empty entry (the feed uses 0 for unidentified orders,
+ * which are never indexed).
+ */
+class OrderIdMap {
+public:
+    explicit OrderIdMap(size_t initial_capacity = 1024);
+
+    /**
+     * @return Slot index for order_id, or kInvalidSlot if absent
+     */
+    uint32_t find(uint64_t order_id) const;
+
+    /**
+     * @return false if order_id is already present (map unchanged)
+     */
+    bool insert(uint64_t order_id, uint32_t slot);
+
+    bool erase(uint64_t order_id);
+    void clear();
+    size_t size() const { return size_; }
+
+private:
+    struct Entry {
+        uint64_t order_id;
+        uint32_t slot;
+    };
+
+    size_t home_index(uint64_t order_id) const {
+        // Fibonacci hashing spreads sequential exchange ids across the table
+        return static_cast<size_t>((order_id * 0x9E3779B97F4A7C15ull) >> shift_);
+    }
+    void grow();
+
+    std::vector<Entry> entries_;
+    size_t mask_;
+    uint32_t shift_;
+    size_t size_;
+};
+
 /**
- * @brief Callback function type for CDC events
+ * @brief Per-symbol sequence tracker that gates what reaches the book
+ *
+ * Tracks the next expected sequence number. Snapshots carry the sequence of
+ * the last event they include; a DeltaBatch covers [seq_start, seq_end].
+ * Duplicate and stale input is dropped; a gap marks the symbol Stale and all
+ * deltas are held back until a snapshot re-seeds it. A sequence of 0 means the
+ * feed does not sequence that message and is accepted as-is; after an unsequenced
+ * snapshot the expected sequence is unknown and the next sequenced batch is adopted.
  */
-using CDCCallback = std::function<void(const CDCEvent&)>;
+class SymbolSequencer {
+public:
+    enum class State : uint8_t {
+        Unseeded,  // No snapshot seen yet
+        Live,      // In sequence
+        Stale      // Gap detected, waiting for a snapshot
+    };
+
+    enum class Result : uint8_t {
+        Apply,      // Continue with the message
+        Duplicate,  // Already covered by the book: drop
+        Gap,        // Sequence gap detected now: symbol became Stale, drop
+        Held        // Symbol is Unseeded or Stale: drop until a snapshot arrives
+    };
+
+    Result on_snapshot(uint64_t seq) {
+        if (state_ == State::Live && seq != 0 && seq < next_expected_) {
+            return Result::Duplicate;
+        }
+        state_ = State::Live;
+        next_expected_ = seq == 0 ? kUnknownSequence : seq + 1;
+        return Result::Apply;
+    }
+
+    Result on_batch(uint64_t seq_start, uint64_t seq_end) {
+        if (state_ != State::Live) return Result::Held;
+        if (seq_end == 0) return Result::Apply;
+        if (next_expected_ == kUnknownSequence) {
+            next_expected_ = seq_end + 1;
+            return Result::Apply;
+        }
+        if (seq_end < next_expected_) return Result::Duplicate;
+        if (seq_start > next_expected_) {
+            state_ = State::Stale;
+            ++gap_count_;
+            return Result::Gap;
+        }
+        // In sequence, or overlapping: events below next_expected() are skipped by the caller
+        next_expected_ = seq_end + 1;
+        return Result::Apply;
+    }
+
+    State state() const { return state_; }
+    uint64_t next_expected() const { return next_expected_; }  // 0 = unknown
+    uint64_t gap_count() const { return gap_count_; }
+
+private:
+    static constexpr uint64_t kUnknownSequence = 0;
+
+    State state_ = State::Unseeded;
+    uint64_t next_expected_ = kUnknownSequence;
+    uint64_t gap_count_ = 0;
+};
 
 /**
- * @brief Order book manager for a single symbol
+ * @brief Live order book for a single symbol
+ *
+ * Not thread-safe: a symbol is only ever processed by the worker that owns its partition.
  */
 class OrderBook {
 public:
-    explicit OrderBook(const std::string& symbol,
-                      const DepthConfig& config = DepthConfig(),
-                      CDCCallback cdc_callback = nullptr);
+    /**
+     * @param exchanges Venues the feed for this book represents; set on every level
+     */
+    explicit OrderBook(const std::string& symbol, ExchangeMask exchanges = 0);
+
+    /**
+     * @brief Seed or re-seed the book from a full snapshot (replaces all state)
+     */
+    void apply_snapshot(const fb::OrderBookSnapshot* snapshot);
+
+    /**
+     * @brief Apply a single delta event
+     * @return false if the event references an order the book does not know
+     */
+    bool apply_delta(const fb::FBBookDeltaEvent* event);
 
-    bool process_snapshot(const fb::OrderBookSnapshot* snapshot);
+    /**
+     * @brief Apply the events of a delta batch in order
+     * @param min_seq Events with a lower (non-zero) seq were already applied and are skipped
+     * @return Number of events applied successfully
+     */
+    size_t apply_delta_batch(const fb::DeltaBatch* batch, uint64_t min_seq = 0);
+
+    /**
+     * @brief Export the top max_levels levels per side into an internal snapshot
+     */
+    void fill_snapshot(InternalOrderBookSnapshot& out, uint32_t max_levels) const;
 
-    const InternalOrderBookSnapshot& get_snapshot() const { return current_snapshot_; }
     const std::string& get_symbol() const { return symbol_; }
     uint64_t get_message_count() const { return message_count_; }
-    uint64_t get_last_sequence() const { return current_snapshot_.sequence; }
+    uint64_t get_last_sequence() const { return last_sequence_; }
+    size_t get_order_count() const { return order_index_.size(); }
     bool is_initialized() const { return initialized_; }
 
-    void set_cdc_callback(CDCCallback callback) { cdc_callback_ = callback; }
+    SymbolSequencer& sequencer() { return sequencer_; }
+    const SymbolSequencer& sequencer() const { return sequencer_; }
 
 private:
-    void process_price_levels(const ::flatbuffers::Vector<::flatbuffers::Offset<fb::OrderMsgLevel>>* levels,
-                             OrderSide side, uint64_t sequence);
-
-    void generate_cdc_events(const std::map<uint64_t, PriceLevel, std::greater<uint64_t>>& old_levels,
-                           const std::map<uint64_t, PriceLevel, std::greater<uint64_t>>& new_levels,
-                           OrderSide side, uint64_t sequence);
+    using BidLevels = std::map<uint64_t, BookLevel, std::greater<uint64_t>>;
+    using AskLevels = std::map<uint64_t, BookLevel>;
 
-    void generate_cdc_events(const std::map<uint64_t, PriceLevel>& old_levels,
-                           const std::map<uint64_t, PriceLevel>& new_levels,
-                           OrderSide side, uint64_t sequence);
+    void clear();
+    void add_order(uint64_t order_id, OrderSide side, uint64_t price, uint64_t quantity);
+    bool remove_order(uint64_t order_id);
+    void reduce_order(uint32_t slot, uint64_t quantity);
 
-    void emit_cdc_event(CDCEventType type, OrderSide side, const PriceLevel& level, uint64_t sequence);
+    uint32_t allocate_slot();
+    void release_slot(uint32_t slot);
+    void unlink_slot(uint32_t slot);
+    BookLevel* find_level(OrderSide side, uint64_t price);
+    void erase_level(OrderSide side, uint64_t price);
 
-    static uint64_t get_timestamp();
+    static OrderSide to_side(fb::Side side) {
+        return side == fb::Side_Sell ? OrderSide::Sell : OrderSide::Buy;
+    }
 
 private:
     std::string symbol_;
-    DepthConfig config_;
-    CDCCallback cdc_callback_;
+    ExchangeMask exchanges_;
 
-    InternalOrderBookSnapshot current_snapshot_;
-    InternalOrderBookSnapshot previous_snapshot_;
+    BidLevels bid_levels_;             // Bids: highest to lowest
+    AskLevels ask_levels_;             // Asks: lowest to highest
+    std::vector<BookOrder> orders_;    // Order pool; slots are recycled through free_slot_
+    uint32_t free_slot_;
+    OrderIdMap order_index_;           // order_id -> slot in orders_
 
+    SymbolSequencer sequencer_;
+    uint64_t last_sequence_;
+    uint64_t last_trade_price_;
+    uint64_t last_trade_quantity_;
     uint64_t message_count_;
     bool initialized_;
 };
 
 /**
- * @brief Order book manager for multiple symbols
+ * @brief Order book registry for multiple symbols
  */
 class OrderBookManager {
 public:
-    explicit OrderBookManager(const DepthConfig& config = DepthConfig(),
-                            CDCCallback global_cdc_callback = nullptr);
+    explicit OrderBookManager(ExchangeMask exchanges = 0) : exchanges_(exchanges) {}
 
+    /**
+     * @brief Returns the book for symbol, creating an empty (uninitialized) one if needed
+     * @note Thread-safe; the returned book itself is owned by one worker at a time.
+     */
     OrderBook* get_or_create_orderbook(const std::string& symbol);
-    bool process_snapshot(const fb::OrderBookSnapshot* snapshot);
+
     std::vector<std::string> get_tracked_symbols() const;
-    ProcessingStats get_aggregate_stats() const;
-    void set_global_cdc_callback(CDCCallback callback) { global_cdc_callback_ = callback; }
+    size_t size() const;
 
 private:
-    DepthConfig config_;
-    CDCCallback global_cdc_callback_;
-
+    ExchangeMask exchanges_;  // Venue mask given to every book created
     std::unordered_map<std::string, std::unique_ptr<OrderBook>> orderbooks_;
     mutable std::shared_mutex orderbooks_mutex_;
-
-    ProcessingStats stats_;
-    mutable std::mutex stats_mutex_;
 };
 
 } // namespace market_depth
 
-#endif /* ORDER_BOOK_HPP_ */
\ No newline at end of file
+#endif /* ORDER_BOOK_HPP_ */
@@ -42,6 +42,22 @@ enum class CDCEventType : uint8_t {
     BookCleared = 3
 };
 
+/**
+ * @brief Default per-side ladder capacity (depth_config.max_price_levels)
+ */
+constexpr uint32_t kDefaultMaxPriceLevels = 100;
+
+/**
+ * @brief Exchange identifiers: a dense id per venue, and a set of venues as a bitmask
+ *
+ * Ids are assigned by ExchangeRegistry; bit n of an ExchangeMask is exchange id n.
+ */
+using ExchangeId = uint8_t;
+using ExchangeMask = uint64_t;
+constexpr uint32_t kMaxExchanges = 64;
+
+constexpr ExchangeMask exchange_bit(ExchangeId id) { return ExchangeMask(1) << id; }
+
 /**
  * @brief Price level in the order book
  */
@@ -49,10 +65,10 @@ struct PriceLevel {
     uint64_t price;
     uint64_t quantity;
     uint32_t num_orders;
-    std::vector<std::string> exchanges;
+    ExchangeMask exchanges;  // Venues contributing to the level
 
     PriceLevel();
-    PriceLevel(uint64_t p, uint64_t qty, uint32_t orders = 1);
+    PriceLevel(uint64_t p, uint64_t qty, uint32_t orders = 1, ExchangeMask venues = 0);
 
     bool operator==(const PriceLevel& other) const;
     bool operator!=(const PriceLevel& other) const;
@@ -72,25 +88,115 @@ struct CDCEvent {
     CDCEvent();
 };
 
+/**
+ * @brief One side of a book as a flat structure-of-arrays price ladder
+ *
+ * Prices, quantities, order counts and venue masks live in separate contiguous arrays,
+ * best level first (bids highest to lowest, asks lowest to highest). Storage
+ * is sized once to a fixed capacity; clear() keeps it, so a reused ladder
+ * never allocates.
+ */
+class PriceLadder {
+public:
+    PriceLadder(OrderSide side, uint32_t capacity);
+
+    /**
+     * @brief Insert a level, or replace the level at the same price, keeping best-first order
+     * @return false if the ladder is full and the level ranks below every held level
+     * @note Levels arriving best-first (the usual case) are appended without searching.
+     */
+    bool insert(uint64_t price, uint64_t quantity, uint32_t num_orders, ExchangeMask exchanges);
+
+    /**
+     * @brief Change the capacity; levels beyond the new capacity are dropped
+     */
+    void set_capacity(uint32_t capacity);
+
+    void clear() { size_ = 0; }
+
+    uint32_t size() const { return size_; }
+    uint32_t capacity() const { return static_cast<uint32_t>(prices_.size()); }
+    bool empty() const { return size_ == 0; }
+    bool full() const { return size_ == capacity(); }
+    OrderSide side() const { return side_; }
+
+    uint64_t price(uint32_t i) const { return prices_[i]; }
+    uint64_t quantity(uint32_t i) const { return quantities_[i]; }
+    uint32_t num_orders(uint32_t i) const { return num_orders_[i]; }
+    ExchangeMask exchanges(uint32_t i) const { return exchanges_[i]; }
+    PriceLevel level(uint32_t i) const {
+        return PriceLevel(prices_[i], quantities_[i], num_orders_[i], exchanges_[i]);
+    }
+
+private:
+    bool ranks_before(uint64_t a, uint64_t b) const {
+        return side_ == OrderSide::Buy ? a > b : a < b;
+    }
+
+    OrderSide side_;
+    uint32_t size_;
+    std::vector<uint64_t> prices_;
+    std::vector<uint64_t> quantities_;
+    std::vector<uint32_t> num_orders_;
+    std::vector<ExchangeMask> exchanges_;
+};
+
+/**
+ * @brief Read-only view of the best levels of a ladder (no copy)
+ */
+class LadderView {
+public:
+    LadderView(const PriceLadder& ladder, uint32_t depth)
+        : ladder_(&ladder), size_(depth < ladder.size() ? depth : ladder.size()) {}
+
+    uint32_t size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+
+    uint64_t price(uint32_t i) const { return ladder_->price(i); }
+    uint64_t quantity(uint32_t i) const { return ladder_->quantity(i); }
+    uint32_t num_orders(uint32_t i) const { return ladder_->num_orders(i); }
+    ExchangeMask exchanges(uint32_t i) const { return ladder_->exchanges(i); }
+    PriceLevel operator[](uint32_t i) const { return ladder_->level(i); }
+
+private:
+    const PriceLadder* ladder_;
+    uint32_t size_;
+};
+
 /**
  * @brief Simplified internal order book snapshot
+ *
+ * Meant to be reused: clear() resets it without releasing ladder storage.
  */
 struct InternalOrderBookSnapshot {
     std::string symbol;
     uint64_t sequence;
     uint64_t timestamp;
+    uint64_t ingest_timestamp_us;  // Kafka timestamp of the input message it was built from (0 = unknown)
+    int32_t source_partition;      // Input partition of that message (-1 = unknown)
 
-    std::map<uint64_t, PriceLevel, std::greater<uint64_t>> bid_levels;  // Bids: highest to lowest
-    std::map<uint64_t, PriceLevel> ask_levels;                          // Asks: lowest to highest
+    PriceLadder bid_levels;  // Bids: highest to lowest
+    PriceLadder ask_levels;  // Asks: lowest to highest
 
     uint64_t last_trade_price;
     uint64_t last_trade_quantity;
 
-    InternalOrderBookSnapshot();
+    explicit InternalOrderBookSnapshot(uint32_t max_price_levels = kDefaultMaxPriceLevels);
 
-    std::vector<PriceLevel> get_top_bids(uint32_t depth) const;
-    std::vector<PriceLevel> get_top_asks(uint32_t depth) const;
+    void clear();
+
+    LadderView get_top_bids(uint32_t depth) const { return LadderView(bid_levels, depth); }
+    LadderView get_top_asks(uint32_t depth) const { return LadderView(ask_levels, depth); }
     bool has_sufficient_depth(uint32_t min_levels = 1) const;
+
+    /**
+     * @brief Fast hash of what the top-depth view shows: level prices, quantities,
+     *        order counts and venues on both sides
+     *
+     * Sequence, timestamp and last trade are deliberately left out, so a new
+     * snapshot that leaves the top levels alone has the same fingerprint.
+     */
+    uint64_t depth_fingerprint(uint32_t depth) const;
 };
 
 } // namespace market_depth
@@ -0,0 +1,112 @@
+/**
+ * @file    OutputBufferPool.hpp
+ * @brief   Pool of reusable payload buffers handed to librdkafka without copying.
+ *
+ * Developer: Equix Technologies
+ * Copyright: Equix Technologies Pty Ltd
+ * Created: June 2025
+ *
+ * Description:
+ *   Payloads are rendered straight into a pooled buffer, produced without
+ *   RD_KAFKA_MSG_F_COPY, and returned to the pool by the producer's
+ *   delivery-report callback once librdkafka no longer needs the bytes.
+ *   Buffers keep their capacity across uses, so steady-state publishing does
+ *   not allocate or copy payloads.
+ */
+
+#pragma once
+
+#ifndef OUTPUT_BUFFER_POOL_HPP_
+#define OUTPUT_BUFFER_POOL_HPP_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Payload buffer owned by the pool while idle and by librdkafka while in flight.
+ */
+struct OutputBuffer {
+    std::string data;
+    uint64_t ingest_timestamp_us = 0;   /* Input Kafka timestamp of the message it renders (0 = unknown). */
+    int32_t source_partition = -1;      /* Input partition of that message. */
+};
+
+/**
+ * @class OutputBufferPool
+ * @brief Thread-safe free list of OutputBuffers.
+ *
+ * acquire() is called by publishing workers, release() by the delivery-report
+ * callback (or by the publisher if produce fails). Up to max_pooled idle
+ * buffers are kept; extra buffers released beyond that are freed.
+ */
+class OutputBufferPool {
+public:
+    explicit OutputBufferPool(size_t max_pooled = 4096, size_t initial_capacity = 4096)
+        : max_pooled_(max_pooled), initial_capacity_(initial_capacity), outstanding_(0) {
+        free_.reserve(max_pooled_);
+    }
+
+    ~OutputBufferPool() {
+        for (OutputBuffer* buffer : free_) {
+            delete buffer;
+        }
+    }
+
+    /**
+     * @brief Returns an empty buffer (capacity retained from earlier use).
+     */
+    OutputBuffer* acquire() {
+        outstanding_.fetch_add(1, std::memory_order_relaxed);
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (!free_.empty()) {
+                OutputBuffer* buffer = free_.back();
+                free_.pop_back();
+                buffer->data.clear();
+                buffer->ingest_timestamp_us = 0;
+                buffer->source_partition = -1;
+                return buffer;
+            }
+        }
+        auto* buffer = new OutputBuffer();
+        buffer->data.reserve(initial_capacity_);
+        return buffer;
+    }
+
+    /**
+     * @brief Returns a buffer to the pool. Safe to call with nullptr.
+     */
+    void release(OutputBuffer* buffer) {
+        if (!buffer) return;
+        outstanding_.fetch_sub(1, std::memory_order_relaxed);
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (free_.size() < max_pooled_) {
+                free_.push_back(buffer);
+                return;
+            }
+        }
+        delete buffer;
+    }
+
+    /**
+     * @brief Number of buffers currently handed out (in flight or being filled).
+     */
+    size_t outstanding() const { return outstanding_.load(std::memory_order_relaxed); }
+
+    OutputBufferPool(const OutputBufferPool&) = delete;
+    OutputBufferPool& operator=(const OutputBufferPool&) = delete;
+
+private:
+    const size_t max_pooled_;
+    const size_t initial_capacity_;
+    std::atomic<size_t> outstanding_;
+    std::mutex mutex_;
+    std::vector<OutputBuffer*> free_;
+};
+
+#endif /* OUTPUT_BUFFER_POOL_HPP_ */
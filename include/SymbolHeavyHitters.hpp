@@ -0,0 +1,180 @@
+/**
+ * @file    SymbolHeavyHitters.hpp
+ * @brief   Bounded top-K message counts per symbol (Space-Saving), sharded per thread
+ *
+ * Developer: Equix Technologies
+ * Copyright: Equix Technologies Pty Ltd
+ * Created: June 2025
+ *
+ * Description:
+ *   The "top symbols" report only needs the heaviest symbols, not an exact
+ *   count for each of ~200k. Every processing thread keeps its own
+ *   Space-Saving summary of at most `capacity` symbols: a symbol that is not
+ *   tracked replaces the current minimum and inherits its count as error, so
+ *   any symbol with more than N/capacity messages is guaranteed to be present.
+ *   Counts are tallied without locking during a batch and folded into the
+ *   thread's summary once per batch; shards are merged only when reported.
+ */
+
+#pragma once
+
+#ifndef SYMBOL_HEAVY_HITTERS_HPP_
+#define SYMBOL_HEAVY_HITTERS_HPP_
+
+#include "SymbolTable.hpp"
+#include "ThreadShards.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+namespace market_depth {
+
+/**
+ * @brief Space-Saving summary over SymbolIds (not thread-safe)
+ */
+class SpaceSavingCounter {
+public:
+    struct Entry {
+        SymbolId id = kInvalidSymbolId;
+        uint64_t count = 0;   // Upper bound of the true count
+        uint64_t error = 0;   // count - error is a lower bound
+    };
+
+    explicit SpaceSavingCounter(size_t capacity) : capacity_(std::max<size_t>(capacity, 1)) {
+        heap_.reserve(capacity_);
+        position_.reserve(capacity_);
+    }
+
+    void add(SymbolId id, uint64_t count = 1) {
+        auto it = position_.find(id);
+        if (it != position_.end()) {
+            heap_[it->second].count += count;
+            sift_down(it->second);
+            return;
+        }
+
+        if (heap_.size() < capacity_) {
+            heap_.push_back({id, count, 0});
+            position_[id] = heap_.size() - 1;
+            sift_up(heap_.size() - 1);
+            return;
+        }
+
+        // Evict the minimum; the newcomer may have been it all along
+        Entry &root = heap_.front();
+        position_.erase(root.id);
+        root = {id, root.count + count, root.count};
+        position_[id] = 0;
+        sift_down(0);
+    }
+
+    const std::vector<Entry> &entries() const { return heap_; }
+
+private:
+    void swap_entries(size_t a, size_t b) {
+        std::swap(heap_[a], heap_[b]);
+        position_[heap_[a].id] = a;
+        position_[heap_[b].id] = b;
+    }
+
+    void sift_up(size_t i) {
+        while (i > 0) {
+            size_t parent = (i - 1) / 2;
+            if (heap_[parent].count <= heap_[i].count) break;
+            swap_entries(i, parent);
+            i = parent;
+        }
+    }
+
+    void sift_down(size_t i) {
+        for (;;) {
+            size_t smallest = i;
+            size_t left = 2 * i + 1;
+            size_t right = left + 1;
+            if (left < heap_.size() && heap_[left].count < heap_[smallest].count) smallest = left;
+            if (right < heap_.size() && heap_[right].count < heap_[smallest].count) smallest = right;
+            if (smallest == i) return;
+            swap_entries(i, smallest);
+            i = smallest;
+        }
+    }
+
+    const size_t capacity_;
+    std::vector<Entry> heap_;                          // Min-heap on count
+    std::unordered_map<SymbolId, size_t> position_;   // id -> index in heap_
+};
+
+/**
+ * @brief Per-thread Space-Saving shards with a merged top-K view
+ *
+ * count() and flush() are called by processing threads, each touching only
+ * its own shard; top() may be called from any thread.
+ */
+class SymbolHeavyHitters {
+public:
+    explicit SymbolHeavyHitters(size_t capacity) : capacity_(capacity) {}
+
+    /**
+     * @brief Tally one message for id (lock-free, applied at the next flush())
+     */
+    void count(SymbolId id) { local().pending.push_back(id); }
+
+    /**
+     * @brief Fold the calling thread's tally into its summary
+     */
+    void flush() {
+        Shard &shard = local();
+        if (shard.pending.empty()) return;
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        for (SymbolId id : shard.pending) {
+            shard.summary.add(id);
+        }
+        shard.pending.clear();
+    }
+
+    /**
+     * @brief Up to k heaviest symbols across all threads, heaviest first
+     */
+    std::vector<SpaceSavingCounter::Entry> top(size_t k) const {
+        std::unordered_map<SymbolId, SpaceSavingCounter::Entry> merged;
+        shards_.for_each([&](const Shard &shard) {
+            std::lock_guard<std::mutex> shard_lock(shard.mutex);
+            for (const auto &entry : shard.summary.entries()) {
+                auto &total = merged[entry.id];
+                total.id = entry.id;
+                total.count += entry.count;
+                total.error += entry.error;
+            }
+        });
+
+        std::vector<SpaceSavingCounter::Entry> result;
+        result.reserve(merged.size());
+        for (const auto &[id, entry] : merged) {
+            result.push_back(entry);
+        }
+        k = std::min(k, result.size());
+        std::partial_sort(result.begin(), result.begin() + static_cast<std::ptrdiff_t>(k), result.end(),
+                          [](const auto &a, const auto &b) { return a.count > b.count; });
+        result.resize(k);
+        return result;
+    }
+
+private:
+    struct Shard {
+        explicit Shard(size_t capacity) : summary(capacity) {}
+        mutable std::mutex mutex;       // Owner thread (flush) vs. reporter (top)
+        SpaceSavingCounter summary;
+        std::vector<SymbolId> pending;  // Owner thread only
+    };
+
+    Shard &local() { return shards_.local(capacity_); }
+
+    const size_t capacity_;
+    ThreadShards<Shard> shards_;
+};
+
+} // namespace market_depth
+
+#endif /* SYMBOL_HEAVY_HITTERS_HPP_ */
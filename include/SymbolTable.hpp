@@ -0,0 +1,110 @@
+/**
+ * @file    SymbolTable.hpp
+ * @brief   Symbol interning: dense SymbolId per symbol with per-symbol publishing state
+ *
+ * Developer: Equix Technologies
+ * Copyright: Equix Technologies Pty Ltd
+ * Created: June 2025
+ *
+ * Description:
+ *   Maps each symbol seen on the input feed to a dense SymbolId the first time
+ *   it appears. Lookups take the FlatBuffers string as a string_view, so the
+ *   hot path neither allocates nor re-hashes the symbol per depth. Everything
+ *   derived from the symbol (output topic name, output partition, producer
+ *   topic handle, live book, depth view state) is computed once and kept in a
+ *   SymbolState slot indexed by the id.
+ */
+
+#pragma once
+
+#ifndef SYMBOL_TABLE_HPP_
+#define SYMBOL_TABLE_HPP_
+
+#include "MessageFactory.hpp"
+#include <librdkafka/rdkafka.h>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+namespace market_depth {
+
+class OrderBook;
+
+using SymbolId = uint32_t;
+constexpr SymbolId kInvalidSymbolId = UINT32_MAX;
+
+/**
+ * @brief Per-symbol state, created once when the symbol is interned
+ *
+ * symbol, topic_name and partition are immutable after interning. topic and
+ * book are resolved lazily by the first publisher (resolving twice is harmless).
+ * depth_views is only touched by the worker that owns the symbol's partition.
+ */
+struct SymbolState {
+    static constexpr size_t kMaxDepthViews = 8;
+
+    /**
+     * @brief Last published content of one configured depth view
+     */
+    struct DepthView {
+        uint64_t fingerprint = 0;
+        uint64_t published_us = 0;  // 0 = never published
+    };
+
+    std::string symbol;
+    std::string topic_name;                          // Output topic: snapshot prefix + symbol
+    uint32_t partition = 0;                          // Output partition (MessageRouter::calculate_partition)
+    std::atomic<rd_kafka_topic_t*> topic{nullptr};   // Producer topic handle
+    std::atomic<OrderBook*> book{nullptr};           // Live book (delta processing only)
+    DepthView depth_views[kMaxDepthViews];           // Indexed like depth_config.levels
+};
+
+/**
+ * @brief Thread-safe symbol -> SymbolId interning table
+ *
+ * SymbolState slots live in fixed-size chunks that never move, so a reference
+ * returned by state() stays valid while the table grows and can be used
+ * without holding any lock.
+ */
+class SymbolTable {
+public:
+    static constexpr uint32_t kChunkBits = 8;
+    static constexpr uint32_t kChunkSize = 1u << kChunkBits;
+    static constexpr uint32_t kMaxChunks = 4096;   // Up to ~1M symbols
+
+    SymbolTable(std::string topic_prefix, const MessageRouter& router);
+
+    /**
+     * @brief Returns the id for symbol, interning it on first sight
+     * @return kInvalidSymbolId if the table is full
+     */
+    SymbolId intern(std::string_view symbol);
+
+    SymbolState& state(SymbolId id) { return chunks_[id >> kChunkBits][id & (kChunkSize - 1)]; }
+    const SymbolState& state(SymbolId id) const { return chunks_[id >> kChunkBits][id & (kChunkSize - 1)]; }
+
+    /**
+     * @brief Number of interned symbols; ids [0, size()) are valid
+     */
+    size_t size() const { return size_.load(std::memory_order_acquire); }
+
+    SymbolTable(const SymbolTable&) = delete;
+    SymbolTable& operator=(const SymbolTable&) = delete;
+
+private:
+    const std::string topic_prefix_;
+    const MessageRouter& router_;
+
+    std::unordered_map<std::string_view, SymbolId> index_;   // Keys view SymbolState::symbol
+    std::unique_ptr<SymbolState[]> chunks_[kMaxChunks];
+    std::atomic<uint32_t> size_;
+    mutable std::shared_mutex mutex_;
+};
+
+} // namespace market_depth
+
+#endif /* SYMBOL_TABLE_HPP_ */
@@ -0,0 +1,108 @@
+/**
+ * @file    ThreadShards.hpp
+ * @brief   One lazily created shard per (instance, thread), for lock-free per-thread recording
+ *
+ * Developer: Equix Technologies
+ * Copyright: Equix Technologies Pty Ltd
+ * Created: June 2025
+ *
+ * Description:
+ *   Recorders that give every writer thread its own state (latency
+ *   histograms, heavy-hitter summaries) own a ThreadShards. A thread's first
+ *   local() on an instance creates its shard under the instance mutex; later
+ *   calls find it in a small per-thread table without locking. Entries are
+ *   keyed by an id that is never reused, so a thread can write to any number
+ *   of instances, and an instance re-created at the same address never sees
+ *   a shard of its predecessor.
+ */
+
+#pragma once
+
+#ifndef THREAD_SHARDS_HPP_
+#define THREAD_SHARDS_HPP_
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+namespace market_depth {
+
+/**
+ * @brief Process-wide unique id for a ThreadShards instance
+ */
+inline uint64_t next_thread_shards_id() {
+    static std::atomic<uint64_t> next{1};
+    return next.fetch_add(1, std::memory_order_relaxed);
+}
+
+/**
+ * @brief Shards owned by one instance, one per thread that touched it
+ *
+ * Shards live as long as the owner, so state written by finished threads is
+ * still visited by for_each().
+ */
+template <typename Shard>
+class ThreadShards {
+public:
+    ThreadShards() : id_(next_thread_shards_id()) {}
+
+    /**
+     * @brief Calling thread's shard, constructed from args on first use
+     */
+    template <typename... Args>
+    Shard &local(Args &&...args) {
+        auto &table = thread_table();
+        for (const auto &entry : table) {
+            if (entry.first == id_) return *entry.second;
+        }
+
+        Shard *shard;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            shards_.push_back(std::make_unique<Shard>(std::forward<Args>(args)...));
+            shard = shards_.back().get();
+        }
+        table.emplace_back(id_, shard);
+        return *shard;
+    }
+
+    /**
+     * @brief Visit every thread's shard under the instance mutex
+     */
+    template <typename Fn>
+    void for_each(Fn &&fn) const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (const auto &shard : shards_) {
+            fn(static_cast<const Shard &>(*shard));
+        }
+    }
+
+    /**
+     * @brief Threads that have a shard
+     */
+    size_t size() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return shards_.size();
+    }
+
+    ThreadShards(const ThreadShards &) = delete;
+    ThreadShards &operator=(const ThreadShards &) = delete;
+
+private:
+    // Per thread and Shard type; entries of destroyed instances are never matched again
+    static std::vector<std::pair<uint64_t, Shard *>> &thread_table() {
+        thread_local std::vector<std::pair<uint64_t, Shard *>> table;
+        return table;
+    }
+
+    const uint64_t id_;
+    mutable std::mutex mutex_;
+    std::vector<std::unique_ptr<Shard>> shards_;
+};
+
+} // namespace market_depth
+
+#endif /* THREAD_SHARDS_HPP_ */
@@ -19,6 +19,9 @@
 #include <spdlog/spdlog.h>
 #include <stdexcept>
 #include <iostream>
+#include <cstring>
+#include <chrono>
+#include <algorithm>
 
 KafkaConsumer& KafkaConsumer::instance() {
     static KafkaConsumer instance;
@@ -26,7 +29,9 @@ KafkaConsumer& KafkaConsumer::instance() {
 }
 
 KafkaConsumer::KafkaConsumer()
-    : consumer_(nullptr), initialized_(false) {}
+    : max_poll_records_(500), catchup_lag_threshold_(0), catchup_lookback_ms_(0), statistics_interval_ms_(0),
+      statistics_(true), consumer_(nullptr), consumer_queue_(nullptr), initialized_(false), paused_(false),
+      lookback_pending_count_(0) {}
 
 KafkaConsumer::~KafkaConsumer() {
     shutdown();
@@ -49,11 +54,22 @@ void KafkaConsumer::initialize(const std::string& config_path) {
     rd_kafka_conf_set(conf, "auto.offset.reset", auto_offset_reset_.c_str(), errstr, sizeof(errstr));
     rd_kafka_conf_set(conf, "enable.auto.commit", enable_auto_commit_.c_str(), errstr, sizeof(errstr));
 
+    // Rebalance callback: needed to split partition queues on assignment
+    rd_kafka_conf_set_opaque(conf, this);
+    rd_kafka_conf_set_rebalance_cb(conf, &KafkaConsumer::rebalance_cb);
+
+    // Statistics: per-partition lag and fetch queue, per-broker RTT
+    if (statistics_interval_ms_ > 0) {
+        rd_kafka_conf_set(conf, "statistics.interval.ms", std::to_string(statistics_interval_ms_).c_str(), errstr, sizeof(errstr));
+        rd_kafka_conf_set_stats_cb(conf, &KafkaConsumer::stats_cb);
+    }
+
     consumer_ = rd_kafka_new(RD_KAFKA_CONSUMER, conf, errstr, sizeof(errstr));
     if (!consumer_)
         throw std::runtime_error("Failed to create Kafka consumer: " + std::string(errstr));
 
     rd_kafka_poll_set_consumer(consumer_); // Required for consumer
+    consumer_queue_ = rd_kafka_queue_get_consumer(consumer_);
 
     initialized_ = true;
     SPDLOG_INFO("KafkaConsumer initialized");
@@ -72,6 +88,18 @@ void KafkaConsumer::parse_config(const std::string& config_path) {
     session_timeout_ms_  = kafka["session_timeout_ms"]? std::to_string(kafka["session_timeout_ms"].as<int>()) : "6000";
     auto_offset_reset_   = kafka["auto_offset_reset"] ? kafka["auto_offset_reset"].as<std::string>() : "earliest";
     enable_auto_commit_  = kafka["enable_auto_commit"]? kafka["enable_auto_commit"].as<bool>() ? "true" : "false" : "true";
+    max_poll_records_    = kafka["max_poll_records"]  ? kafka["max_poll_records"].as<size_t>()       : 500;
+    if (max_poll_records_ == 0)
+        max_poll_records_ = 1;
+    catchup_lag_threshold_ = kafka["catchup_lag_threshold"] ? kafka["catchup_lag_threshold"].as<int64_t>() : 0;
+    catchup_lookback_ms_   = kafka["catchup_lookback_ms"]   ? kafka["catchup_lookback_ms"].as<int64_t>()   : 0;
+    statistics_interval_ms_ = kafka["statistics_interval_ms"] ? kafka["statistics_interval_ms"].as<int>() : 0;
+}
+
+int KafkaConsumer::stats_cb(rd_kafka_t* /*rk*/, char* json, size_t json_len, void* opaque) {
+    if (auto* self = static_cast<KafkaConsumer*>(opaque))
+        self->statistics_.update(json, json_len);
+    return 0; // librdkafka frees json
 }
 
 void KafkaConsumer::subscribe(const std::vector<std::string>& topics) {
@@ -95,7 +123,6 @@ void KafkaConsumer::subscribe(const std::vector<std::string>& topics) {
 }
 
 rd_kafka_message_t* KafkaConsumer::consume(int timeout_ms) {
-    SPDLOG_INFO("KafkaConsumer subscribed to {} servers", bootstrap_servers_);
     std::shared_lock lock(consumer_mutex_);
     if (!consumer_)
         return nullptr;
@@ -104,11 +131,327 @@ rd_kafka_message_t* KafkaConsumer::consume(int timeout_ms) {
     return msg; // msg is managed by caller (must call rd_kafka_message_destroy)
 }
 
+size_t KafkaConsumer::consume_batch(rd_kafka_message_t** messages, size_t max_messages, int timeout_ms) {
+    std::shared_lock lock(consumer_mutex_);
+    if (!consumer_queue_)
+        return 0;
+
+    ssize_t count = rd_kafka_consume_batch_queue(consumer_queue_, timeout_ms, messages, max_messages);
+    if (count <= 0)
+        return 0;
+    if (lookback_pending_count_.load(std::memory_order_acquire) > 0)
+        return seek_lagging_partitions(messages, static_cast<size_t>(count));
+    return static_cast<size_t>(count);
+}
+
+void KafkaConsumer::enable_partition_queues(size_t num_queues) {
+    std::unique_lock lock(consumer_mutex_);
+
+    if (!consumer_)
+        throw std::runtime_error("KafkaConsumer::enable_partition_queues: Consumer not initialized");
+    if (!partition_queues_.empty() || num_queues == 0)
+        return;
+
+    partition_queues_.reserve(num_queues);
+    for (size_t i = 0; i < num_queues; ++i) {
+        partition_queues_.push_back(rd_kafka_queue_new(consumer_));
+    }
+
+    SPDLOG_INFO("KafkaConsumer partition queues enabled: {} worker queues", num_queues);
+}
+
+rd_kafka_message_t* KafkaConsumer::consume_partition_queue(size_t queue_index, int timeout_ms) {
+    // partition_queues_ is immutable while consumption runs, so no lock is taken here
+    if (queue_index >= partition_queues_.size())
+        return nullptr;
+    return rd_kafka_consume_queue(partition_queues_[queue_index], timeout_ms);
+}
+
+size_t KafkaConsumer::consume_partition_batch(size_t queue_index, rd_kafka_message_t** messages,
+                                              size_t max_messages, int timeout_ms) {
+    if (queue_index >= partition_queues_.size())
+        return 0;
+
+    ssize_t count = rd_kafka_consume_batch_queue(partition_queues_[queue_index], timeout_ms, messages, max_messages);
+    if (count <= 0)
+        return 0;
+    if (lookback_pending_count_.load(std::memory_order_acquire) > 0)
+        return seek_lagging_partitions(messages, static_cast<size_t>(count));
+    return static_cast<size_t>(count);
+}
+
+void KafkaConsumer::rebalance_cb(rd_kafka_t* rk, rd_kafka_resp_err_t err,
+                                 rd_kafka_topic_partition_list_t* partitions, void* opaque) {
+    auto* self = static_cast<KafkaConsumer*>(opaque);
+    const bool cooperative = std::strcmp(rd_kafka_rebalance_protocol(rk), "COOPERATIVE") == 0;
+
+    switch (err) {
+        case RD_KAFKA_RESP_ERR__ASSIGN_PARTITIONS:
+            SPDLOG_INFO("KafkaConsumer partitions assigned: {}", partitions->cnt);
+            if (cooperative) {
+                if (rd_kafka_error_t* error = rd_kafka_incremental_assign(rk, partitions)) {
+                    SPDLOG_ERROR("KafkaConsumer incremental assign failed: {}", rd_kafka_error_string(error));
+                    rd_kafka_error_destroy(error);
+                    return;
+                }
+            } else {
+                rd_kafka_assign(rk, partitions);
+            }
+            self->forward_partition_queues(rk, partitions);
+            // Keep flow control in force across rebalances
+            if (self->paused_.load(std::memory_order_relaxed)) {
+                rd_kafka_pause_partitions(rk, partitions);
+            }
+            // The lookback seek waits for the first fetch, outside this callback
+            self->update_lookback_pending(partitions, true);
+            break;
+
+        case RD_KAFKA_RESP_ERR__REVOKE_PARTITIONS:
+            SPDLOG_INFO("KafkaConsumer partitions revoked: {}", partitions->cnt);
+            if (cooperative) {
+                if (rd_kafka_error_t* error = rd_kafka_incremental_unassign(rk, partitions)) {
+                    SPDLOG_ERROR("KafkaConsumer incremental unassign failed: {}", rd_kafka_error_string(error));
+                    rd_kafka_error_destroy(error);
+                }
+                self->update_lookback_pending(partitions, false);
+            } else {
+                rd_kafka_assign(rk, nullptr);
+                self->update_lookback_pending(nullptr, false);
+            }
+            break;
+
+        default:
+            SPDLOG_ERROR("KafkaConsumer rebalance error: {}", rd_kafka_err2str(err));
+            rd_kafka_assign(rk, nullptr);
+            self->update_lookback_pending(nullptr, false);
+            break;
+    }
+}
+
+void KafkaConsumer::forward_partition_queues(rd_kafka_t* rk, const rd_kafka_topic_partition_list_t* partitions) {
+    if (partition_queues_.empty())
+        return;
+
+    for (int i = 0; i < partitions->cnt; ++i) {
+        const rd_kafka_topic_partition_t& tp = partitions->elems[i];
+        rd_kafka_queue_t* partition_queue = rd_kafka_queue_get_partition(rk, tp.topic, tp.partition);
+        if (!partition_queue) {
+            SPDLOG_WARN("KafkaConsumer: no queue for {} [{}], left on consumer queue", tp.topic, tp.partition);
+            continue;
+        }
+        size_t worker = static_cast<size_t>(tp.partition) % partition_queues_.size();
+        rd_kafka_queue_forward(partition_queue, partition_queues_[worker]);
+        rd_kafka_queue_destroy(partition_queue); // Forwarding outlives the handle
+        SPDLOG_DEBUG("KafkaConsumer: {} [{}] forwarded to worker queue {}", tp.topic, tp.partition, worker);
+    }
+}
+
+void KafkaConsumer::update_lookback_pending(const rd_kafka_topic_partition_list_t* partitions, bool assigned) {
+    if (catchup_lag_threshold_ <= 0 || catchup_lookback_ms_ <= 0)
+        return;
+
+    std::lock_guard<std::mutex> lock(lookback_mutex_);
+    if (!partitions) {
+        lookback_pending_.clear();
+    } else {
+        for (int i = 0; i < partitions->cnt; ++i) {
+            const rd_kafka_topic_partition_t& tp = partitions->elems[i];
+            auto it = std::find_if(lookback_pending_.begin(), lookback_pending_.end(), [&](const auto& pending) {
+                return pending.second == tp.partition && pending.first == tp.topic;
+            });
+            if (assigned && it == lookback_pending_.end())
+                lookback_pending_.emplace_back(tp.topic, tp.partition);
+            else if (!assigned && it != lookback_pending_.end())
+                lookback_pending_.erase(it);
+        }
+    }
+    lookback_pending_count_.store(lookback_pending_.size(), std::memory_order_release);
+}
+
+size_t KafkaConsumer::seek_lagging_partitions(rd_kafka_message_t** messages, size_t count) {
+    constexpr int kQueryTimeoutMs = 5000;
+
+    const int64_t lookback_start_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count() - catchup_lookback_ms_;
+
+    // Pending partitions seen in this batch that started too far behind; lagging_start[i] is elems[i]'s first offset
+    rd_kafka_topic_partition_list_t* lagging = nullptr;
+    std::vector<int64_t> lagging_start;
+    {
+        std::lock_guard<std::mutex> lock(lookback_mutex_);
+        for (size_t i = 0; i < count && !lookback_pending_.empty(); ++i) {
+            const rd_kafka_message_t* msg = messages[i];
+            if (msg->err || !msg->rkt)
+                continue;
+
+            const char* topic = rd_kafka_topic_name(msg->rkt);
+            auto it = std::find_if(lookback_pending_.begin(), lookback_pending_.end(), [&](const auto& pending) {
+                return pending.second == msg->partition && pending.first == topic;
+            });
+            if (it == lookback_pending_.end())
+                continue;
+            lookback_pending_.erase(it);
+
+            int64_t low = 0, high = 0;
+            if (rd_kafka_get_watermark_offsets(consumer_, topic, msg->partition, &low, &high) || high < 0 ||
+                high - msg->offset <= catchup_lag_threshold_)
+                continue;
+
+            SPDLOG_INFO("KafkaConsumer catch-up: {} [{}] is {} messages behind, looking back {} ms",
+                        topic, msg->partition, high - msg->offset, catchup_lookback_ms_);
+            if (!lagging)
+                lagging = rd_kafka_topic_partition_list_new(1);
+            rd_kafka_topic_partition_list_add(lagging, topic, msg->partition)->offset = lookback_start_ms;
+            lagging_start.push_back(msg->offset);
+        }
+        lookback_pending_count_.store(lookback_pending_.size(), std::memory_order_release);
+    }
+    if (!lagging)
+        return count;
+
+    // One timestamp lookup for every lagging partition of the batch
+    rd_kafka_resp_err_t err = rd_kafka_offsets_for_times(consumer_, lagging, kQueryTimeoutMs);
+    if (err) {
+        SPDLOG_WARN("KafkaConsumer catch-up: offsets_for_times failed: {}", rd_kafka_err2str(err));
+        rd_kafka_topic_partition_list_destroy(lagging);
+        return count;
+    }
+
+    rd_kafka_topic_partition_list_t* seek = rd_kafka_topic_partition_list_new(lagging->cnt);
+    for (int i = 0; i < lagging->cnt; ++i) {
+        const rd_kafka_topic_partition_t& tp = lagging->elems[i];
+        // -1 (no message newer than the lookback) starts from the end; never move backwards
+        if (tp.err || (tp.offset >= 0 && tp.offset <= lagging_start[i]))
+            continue;
+        rd_kafka_topic_partition_list_add(seek, tp.topic, tp.partition)->offset = tp.offset;
+        SPDLOG_INFO("KafkaConsumer catch-up: {} [{}] starts at offset {}", tp.topic, tp.partition, tp.offset);
+    }
+    rd_kafka_topic_partition_list_destroy(lagging);
+
+    // Seeking is local to the fetcher (no broker round trip) and purges what was fetched before it
+    bool seeked = seek->cnt > 0;
+    if (seeked) {
+        if (rd_kafka_error_t* error = rd_kafka_seek_partitions(consumer_, seek, kQueryTimeoutMs)) {
+            SPDLOG_WARN("KafkaConsumer catch-up: seek failed: {}", rd_kafka_error_string(error));
+            rd_kafka_error_destroy(error);
+            seeked = false;
+        }
+    }
+
+    // Drop the batch's messages from before each new start
+    size_t kept = 0;
+    for (size_t i = 0; i < count; ++i) {
+        rd_kafka_message_t* msg = messages[i];
+        bool skipped = false;
+        if (seeked && !msg->err && msg->rkt) {
+            for (int j = 0; j < seek->cnt; ++j) {
+                const rd_kafka_topic_partition_t& tp = seek->elems[j];
+                if (tp.partition == msg->partition && std::strcmp(tp.topic, rd_kafka_topic_name(msg->rkt)) == 0) {
+                    skipped = tp.err == RD_KAFKA_RESP_ERR_NO_ERROR && (tp.offset < 0 || msg->offset < tp.offset);
+                    break;
+                }
+            }
+        }
+        if (skipped)
+            rd_kafka_message_destroy(msg);
+        else
+            messages[kept++] = msg;
+    }
+    rd_kafka_topic_partition_list_destroy(seek);
+    return kept;
+}
+
+int64_t KafkaConsumer::lag(const rd_kafka_message_t* msg) const {
+    if (!consumer_ || !msg || !msg->rkt)
+        return -1;
+
+    int64_t low = 0, high = 0;
+    if (rd_kafka_get_watermark_offsets(consumer_, rd_kafka_topic_name(msg->rkt), msg->partition, &low, &high) ||
+        high < 0)
+        return -1;
+    return std::max<int64_t>(high - (msg->offset + 1), 0);
+}
+
+std::vector<PartitionLag> KafkaConsumer::partition_lags() const {
+    std::vector<PartitionLag> lags;
+    std::shared_lock lock(consumer_mutex_);
+    if (!consumer_)
+        return lags;
+
+    rd_kafka_topic_partition_list_t* assignment = nullptr;
+    if (rd_kafka_assignment(consumer_, &assignment) || !assignment)
+        return lags;
+
+    if (rd_kafka_position(consumer_, assignment) == RD_KAFKA_RESP_ERR_NO_ERROR) {
+        lags.reserve(assignment->cnt);
+        for (int i = 0; i < assignment->cnt; ++i) {
+            const rd_kafka_topic_partition_t& tp = assignment->elems[i];
+            PartitionLag entry;
+            entry.topic = tp.topic;
+            entry.partition = tp.partition;
+            entry.position = tp.offset >= 0 ? tp.offset : -1;
+
+            int64_t low = 0, high = 0;
+            if (!rd_kafka_get_watermark_offsets(consumer_, tp.topic, tp.partition, &low, &high) && high >= 0)
+                entry.high_watermark = high;
+            if (entry.position >= 0 && entry.high_watermark >= 0)
+                entry.lag = std::max<int64_t>(entry.high_watermark - entry.position, 0);
+            lags.push_back(std::move(entry));
+        }
+    }
+    rd_kafka_topic_partition_list_destroy(assignment);
+    return lags;
+}
+
+bool KafkaConsumer::pause_assignment() {
+    return set_assignment_paused(true);
+}
+
+bool KafkaConsumer::resume_assignment() {
+    return set_assignment_paused(false);
+}
+
+bool KafkaConsumer::set_assignment_paused(bool pause) {
+    std::shared_lock lock(consumer_mutex_);
+    if (!consumer_)
+        return false;
+
+    rd_kafka_topic_partition_list_t* assignment = nullptr;
+    rd_kafka_resp_err_t err = rd_kafka_assignment(consumer_, &assignment);
+    if (err) {
+        SPDLOG_WARN("KafkaConsumer: failed to get assignment: {}", rd_kafka_err2str(err));
+        return false;
+    }
+
+    // Set first so a concurrent rebalance pauses (or not) its new partitions accordingly
+    paused_.store(pause, std::memory_order_relaxed);
+    err = pause ? rd_kafka_pause_partitions(consumer_, assignment)
+                : rd_kafka_resume_partitions(consumer_, assignment);
+    const int count = assignment->cnt;
+    rd_kafka_topic_partition_list_destroy(assignment);
+
+    if (err) {
+        paused_.store(!pause, std::memory_order_relaxed);
+        SPDLOG_WARN("KafkaConsumer: failed to {} partitions: {}", pause ? "pause" : "resume", rd_kafka_err2str(err));
+        return false;
+    }
+    SPDLOG_INFO("KafkaConsumer {} {} partitions", pause ? "paused" : "resumed", count);
+    return true;
+}
+
 void KafkaConsumer::shutdown() {
     std::unique_lock lock(consumer_mutex_);
     if (consumer_) {
         SPDLOG_INFO("KafkaConsumer flush and close");
         rd_kafka_consumer_close(consumer_);
+        if (consumer_queue_) {
+            rd_kafka_queue_destroy(consumer_queue_);
+            consumer_queue_ = nullptr;
+        }
+        for (rd_kafka_queue_t* queue : partition_queues_) {
+            rd_kafka_queue_destroy(queue);
+        }
+        partition_queues_.clear();
         rd_kafka_destroy(consumer_);
         consumer_ = nullptr;
     }
@@ -14,6 +14,7 @@
  */
 
 #include "KafkaProducer.hpp"
+#include "LogThrottle.hpp"
 #include <yaml-cpp/yaml.h>
 #include <stdexcept>
 #include <iostream>
@@ -31,7 +32,10 @@ KafkaProducer& KafkaProducer::instance() {
  * @brief Constructs a KafkaProducer. Members are initialized to safe defaults.
  */
 KafkaProducer::KafkaProducer()
-    : producer_(nullptr), initialized_(false) {}
+    : queue_capacity_(1000000), retry_ring_size_(10000), statistics_interval_ms_(0), statistics_(false), producer_(nullptr), service_running_(false),
+      delivered_(0), delivery_failures_(0),
+      retry_head_(0), retry_count_(0), retry_parked_(0), retry_dropped_(0),
+      initialized_(false) {}
 
 /**
  * @brief Destructor. Ensures all resources are released and the producer is properly shut down.
@@ -64,6 +68,16 @@ void KafkaProducer::initialize(const std::string& config_path) {
     rd_kafka_conf_set(conf, "compression.type", compression_.c_str(), errstr, sizeof(errstr));
     rd_kafka_conf_set(conf, "acks", acks_.c_str(), errstr, sizeof(errstr));
 
+    // Delivery reports return zero-copy payload buffers to the pool
+    rd_kafka_conf_set_opaque(conf, this);
+    rd_kafka_conf_set_dr_msg_cb(conf, &KafkaProducer::delivery_report_cb);
+
+    // Statistics: producer queue, batch sizes, per-broker RTT and in-flight requests
+    if (statistics_interval_ms_ > 0) {
+        rd_kafka_conf_set(conf, "statistics.interval.ms", std::to_string(statistics_interval_ms_).c_str(), errstr, sizeof(errstr));
+        rd_kafka_conf_set_stats_cb(conf, &KafkaProducer::stats_cb);
+    }
+
     // Instantiate the producer handle
     producer_ = rd_kafka_new(RD_KAFKA_PRODUCER, conf, errstr, sizeof(errstr));
     if (!producer_) {
@@ -71,9 +85,33 @@ void KafkaProducer::initialize(const std::string& config_path) {
         throw std::runtime_error("Failed to create Kafka producer: " + std::string(errstr));
     }
 
+    retry_ring_.assign(retry_ring_size_, PendingMessage{nullptr, 0, nullptr});
+    retry_head_ = 0;
+    retry_count_ = 0;
+
+    // Dedicated thread serves delivery reports; publishers never block on the producer
+    service_running_ = true;
+    service_thread_ = std::thread(&KafkaProducer::service_loop, this);
+
     initialized_ = true; // Mark as initialized to prevent re-init
 }
 
+/**
+ * @brief Polls the producer until shutdown. rd_kafka_poll() returns as soon as
+ *        events are served, so delivery reports are handled with minimal delay.
+ */
+void KafkaProducer::service_loop() {
+    SPDLOG_INFO("KafkaProducer service thread started");
+    while (service_running_.load(std::memory_order_relaxed)) {
+        // Poll briefly while messages are parked so they go out as soon as the queue drains
+        rd_kafka_poll(producer_, retry_pending() > 0 ? 10 : 100);
+        if (retry_pending() > 0) {
+            drain_retry_ring();
+        }
+    }
+    SPDLOG_INFO("KafkaProducer service thread stopped");
+}
+
 /**
  * @brief Loads and parses the Kafka configuration from a YAML file.
  * @param config_path Path to the YAML configuration file.
@@ -97,6 +135,9 @@ void KafkaProducer::parse_config(const std::string& config_path) {
     queue_buffering_max_messages_ = kafka_config["queue_buffering_max_messages"] ? std::to_string(kafka_config["queue_buffering_max_messages"].as<int>()) : "1000000";
     batch_num_messages_ = kafka_config["batch_num_messages"] ? std::to_string(kafka_config["batch_num_messages"].as<int>()) : "10000";
     linger_ms_ = kafka_config["linger_ms"] ? std::to_string(kafka_config["linger_ms"].as<int>()) : "5";
+    queue_capacity_ = std::stoul(queue_buffering_max_messages_);
+    retry_ring_size_ = kafka_config["retry_ring_size"] ? kafka_config["retry_ring_size"].as<size_t>() : 10000;
+    statistics_interval_ms_ = kafka_config["statistics_interval_ms"] ? kafka_config["statistics_interval_ms"].as<int>() : 0;
 
     // Extract topic list from YAML
     topics_.clear();
@@ -109,6 +150,145 @@ void KafkaProducer::parse_config(const std::string& config_path) {
     SPDLOG_INFO("Parse_config: bootstrap_servers={} compression={}", bootstrap_servers_, compression_);
 }
 
+/**
+ * @brief Delivery-report callback, invoked from rd_kafka_poll()/rd_kafka_flush().
+ *        The per-message opaque is the OutputBuffer the payload lives in (nullptr
+ *        for copied payloads); it is handed back to the pool now that librdkafka
+ *        is done with it.
+ */
+void KafkaProducer::delivery_report_cb(rd_kafka_t* /*rk*/, const rd_kafka_message_t* rkmessage, void* opaque) {
+    auto* self = static_cast<KafkaProducer*>(opaque);
+
+    if (rkmessage->err) {
+        MD_WARN_RATE_LIMITED(10, "Delivery failed for topic {} partition {}: {}",
+                             rkmessage->rkt ? rd_kafka_topic_name(rkmessage->rkt) : "?",
+                             rkmessage->partition, rd_kafka_err2str(rkmessage->err));
+        if (self) self->delivery_failures_.fetch_add(1, std::memory_order_relaxed);
+    } else if (self) {
+        self->delivered_.fetch_add(1, std::memory_order_relaxed);
+
+        // Time from produce() to broker acknowledgement, -1 if unavailable
+        int64_t latency_us = rd_kafka_message_latency(rkmessage);
+        // Delivery reports are served by one thread at a time (service thread, then shutdown flush)
+        if (latency_us >= 0) {
+            self->delivery_latency_.record(static_cast<uint64_t>(latency_us) * 1000);
+        }
+
+        const auto* buffer = static_cast<const OutputBuffer*>(rkmessage->_private);
+        if (buffer && buffer->ingest_timestamp_us != 0) {
+            self->ingest_delivery_latency_.record(
+                buffer->source_partition,
+                market_depth::wall_latency_ns(buffer->ingest_timestamp_us, market_depth::latency_wall_clock_us()));
+        }
+    }
+
+    if (self && rkmessage->_private) {
+        self->buffer_pool_.release(static_cast<OutputBuffer*>(rkmessage->_private));
+    }
+}
+
+/**
+ * @brief Statistics callback, invoked from rd_kafka_poll() on the service thread.
+ */
+int KafkaProducer::stats_cb(rd_kafka_t* /*rk*/, char* json, size_t json_len, void* opaque) {
+    if (auto* self = static_cast<KafkaProducer*>(opaque)) {
+        self->statistics_.update(json, json_len);
+    }
+    return 0; // librdkafka frees json
+}
+
+/**
+ * @brief Returns a snapshot of the delivery counters.
+ */
+DeliveryStats KafkaProducer::delivery_stats() const {
+    DeliveryStats stats;
+    stats.delivered = delivered_.load(std::memory_order_relaxed);
+    stats.failed = delivery_failures_.load(std::memory_order_relaxed);
+    stats.parked = retry_parked_.load(std::memory_order_relaxed);
+    stats.dropped = retry_dropped_.load(std::memory_order_relaxed);
+    return stats;
+}
+
+/**
+ * @brief Produces a pooled buffer without copying, parking it for retry on QUEUE_FULL.
+ */
+bool KafkaProducer::produce_buffer(rd_kafka_topic_t* topic, int32_t partition, OutputBuffer* buffer) {
+    // While messages are parked, new ones queue behind them to keep output ordered
+    if (retry_pending() == 0) {
+        int ret = rd_kafka_produce(
+            topic,
+            partition,
+            0,  // No RD_KAFKA_MSG_F_COPY / F_FREE: payload stays in the pooled buffer until delivery
+            const_cast<char*>(buffer->data.data()), buffer->data.size(),
+            nullptr, 0,
+            buffer);
+        if (ret == 0) return true;
+
+        rd_kafka_resp_err_t err = rd_kafka_last_error();
+        if (err != RD_KAFKA_RESP_ERR__QUEUE_FULL) {
+            MD_WARN_RATE_LIMITED(10, "Push failed for topic {} partition {}: {}",
+                                 rd_kafka_topic_name(topic), partition, rd_kafka_err2str(err));
+            buffer_pool_.release(buffer);
+            return false;
+        }
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(retry_mutex_);
+        const size_t count = retry_count_.load(std::memory_order_relaxed);
+        if (count < retry_ring_.size()) {
+            retry_ring_[(retry_head_ + count) % retry_ring_.size()] = PendingMessage{topic, partition, buffer};
+            retry_count_.store(count + 1, std::memory_order_relaxed);
+            retry_parked_.fetch_add(1, std::memory_order_relaxed);
+            return true;
+        }
+    }
+
+    retry_dropped_.fetch_add(1, std::memory_order_relaxed);
+    MD_WARN_RATE_LIMITED(10, "Producer queue and retry ring full, dropping message for topic {} partition {}",
+                         rd_kafka_topic_name(topic), partition);
+    buffer_pool_.release(buffer);
+    return false;
+}
+
+/**
+ * @brief Re-produces parked messages oldest first; stops at the first QUEUE_FULL.
+ */
+void KafkaProducer::drain_retry_ring() {
+    std::lock_guard<std::mutex> lock(retry_mutex_);
+    size_t count = retry_count_.load(std::memory_order_relaxed);
+
+    while (count > 0) {
+        PendingMessage& pending = retry_ring_[retry_head_];
+        int ret = rd_kafka_produce(
+            pending.topic,
+            pending.partition,
+            0,
+            const_cast<char*>(pending.buffer->data.data()), pending.buffer->data.size(),
+            nullptr, 0,
+            pending.buffer);
+        if (ret == -1) {
+            rd_kafka_resp_err_t err = rd_kafka_last_error();
+            if (err == RD_KAFKA_RESP_ERR__QUEUE_FULL) break;
+
+            MD_WARN_RATE_LIMITED(10, "Retry failed for topic {} partition {}: {}",
+                                 rd_kafka_topic_name(pending.topic), pending.partition, rd_kafka_err2str(err));
+            delivery_failures_.fetch_add(1, std::memory_order_relaxed);
+            buffer_pool_.release(pending.buffer);
+        }
+
+        pending = PendingMessage{nullptr, 0, nullptr};
+        retry_head_ = (retry_head_ + 1) % retry_ring_.size();
+        --count;
+    }
+
+    retry_count_.store(count, std::memory_order_relaxed);
+}
+
+size_t KafkaProducer::queue_depth() const {
+    return (producer_ ? static_cast<size_t>(rd_kafka_outq_len(producer_)) : 0) + retry_pending();
+}
+
 /**
  * @brief Returns the underlying librdkafka producer handle.
  * @return Pointer to the producer instance, or nullptr if not initialized.
@@ -158,6 +338,24 @@ void KafkaProducer::preallocate_topics(const std::vector<std::string>& topic_nam
  * Should be called before application exit to prevent message loss.
  */
 void KafkaProducer::shutdown() {
+    // Stop the service thread first; flush below serves the remaining delivery reports
+    service_running_ = false;
+    if (service_thread_.joinable()) {
+        service_thread_.join();
+    }
+
+    // Give parked messages a last chance, then return whatever is left to the pool
+    if (producer_ && retry_pending() > 0) {
+        drain_retry_ring();
+        std::lock_guard<std::mutex> lock(retry_mutex_);
+        for (size_t i = 0, count = retry_count_.load(); i < count; ++i) {
+            PendingMessage& pending = retry_ring_[(retry_head_ + i) % retry_ring_.size()];
+            buffer_pool_.release(pending.buffer);
+            retry_dropped_.fetch_add(1, std::memory_order_relaxed);
+        }
+        retry_count_ = 0;
+    }
+
     // Destroy all topic handles safely
     {
     SPDLOG_INFO("KafkaProducer Shutdown: Flushing and destroying producer and all topic handles");
@@ -171,6 +369,9 @@ void KafkaProducer::shutdown() {
     // Flush and destroy the producer
     if (producer_) {
         rd_kafka_flush(producer_, 10000); // Wait up to 10s for message delivery
+        // Anything still queued is purged; serving its delivery reports returns pooled buffers
+        rd_kafka_purge(producer_, RD_KAFKA_PURGE_F_QUEUE | RD_KAFKA_PURGE_F_INFLIGHT);
+        rd_kafka_poll(producer_, 0);
         rd_kafka_destroy(producer_);
         producer_ = nullptr;
     }
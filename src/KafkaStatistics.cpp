@@ -0,0 +1,127 @@
+/**
+ * @file    KafkaStatistics.cpp
+ * @brief   librdkafka statistics JSON parsing.
+ */
+
+#include "KafkaStatistics.hpp"
+#include "LogThrottle.hpp"
+#include "spdlog/spdlog.h"
+#include <nlohmann/json.hpp>
+#include <algorithm>
+
+namespace {
+
+int64_t get_int(const nlohmann::json& node, const char* key, int64_t fallback = 0) {
+    auto it = node.find(key);
+    return it != node.end() && it->is_number() ? it->get<int64_t>() : fallback;
+}
+
+} // namespace
+
+KafkaStatistics::KafkaStatistics(bool keep_partitions)
+    : keep_partitions_(keep_partitions), total_consumer_lag_(0), max_consumer_lag_(0),
+      fetch_queue_messages_(0), max_broker_rtt_us_(0), updates_(0) {}
+
+void KafkaStatistics::update(const char* json, size_t len) {
+    // Skip topics.<name>.partitions while parsing when partitions are not wanted
+    const bool keep_partitions = keep_partitions_;
+    nlohmann::json::parser_callback_t filter =
+        [keep_partitions](int depth, nlohmann::json::parse_event_t event, nlohmann::json& parsed) {
+            return keep_partitions || depth != 3 || event != nlohmann::json::parse_event_t::key ||
+                   parsed != "partitions";
+        };
+
+    nlohmann::json doc;
+    try {
+        doc = nlohmann::json::parse(json, json + len, filter);
+    } catch (const nlohmann::json::exception& e) {
+        MD_WARN_RATE_LIMITED(1, "KafkaStatistics: failed to parse statistics JSON: {}", e.what());
+        return;
+    }
+
+    auto stats = std::make_shared<KafkaStatsSnapshot>();
+    stats->client = doc.value("name", "");
+    stats->msg_cnt = get_int(doc, "msg_cnt");
+    stats->msg_size = get_int(doc, "msg_size");
+
+    int64_t max_rtt = 0;
+    auto brokers = doc.find("brokers");
+    if (brokers != doc.end() && brokers->is_object()) {
+        for (const auto& broker : *brokers) {
+            if (get_int(broker, "nodeid", -1) < 0) continue;  // Bootstrap and internal brokers
+
+            KafkaBrokerStats entry;
+            entry.name = broker.value("name", "");
+            entry.state = broker.value("state", "");
+            entry.outbuf_cnt = get_int(broker, "outbuf_cnt");
+            entry.waitresp_cnt = get_int(broker, "waitresp_cnt");
+            entry.tx_errors = get_int(broker, "txerrs");
+            entry.rx_errors = get_int(broker, "rxerrs");
+            auto rtt = broker.find("rtt");
+            if (rtt != broker.end() && rtt->is_object()) {
+                entry.rtt_avg_us = get_int(*rtt, "avg");
+                entry.rtt_p99_us = get_int(*rtt, "p99");
+            }
+            max_rtt = std::max(max_rtt, entry.rtt_p99_us);
+            stats->brokers.push_back(std::move(entry));
+        }
+    }
+
+    int64_t total_lag = 0, max_lag = 0, fetchq = 0;
+    int64_t batch_bytes = 0, batch_msgs = 0, batches = 0;
+    auto topics = doc.find("topics");
+    if (topics != doc.end() && topics->is_object()) {
+        for (const auto& topic : *topics) {
+            auto batchsize = topic.find("batchsize");
+            auto batchcnt = topic.find("batchcnt");
+            if (batchsize != topic.end() && batchcnt != topic.end()) {
+                batch_bytes += get_int(*batchsize, "sum");
+                batch_msgs += get_int(*batchcnt, "sum");
+                batches += get_int(*batchsize, "cnt");
+            }
+
+            auto partitions = topic.find("partitions");
+            if (partitions == topic.end() || !partitions->is_object()) continue;
+            for (const auto& partition : *partitions) {
+                const int64_t id = get_int(partition, "partition", -1);
+                if (id < 0) continue;  // Internal unassigned partition
+
+                KafkaPartitionStats entry;
+                entry.topic = topic.value("topic", "");
+                entry.partition = static_cast<int32_t>(id);
+                entry.consumer_lag = get_int(partition, "consumer_lag", -1);
+                entry.hi_offset = get_int(partition, "hi_offset", -1);
+                entry.committed_offset = get_int(partition, "committed_offset", -1);
+                entry.fetchq_cnt = get_int(partition, "fetchq_cnt");
+                entry.fetchq_size = get_int(partition, "fetchq_size");
+
+                // Only partitions being fetched report a lag
+                if (entry.consumer_lag >= 0) {
+                    total_lag += entry.consumer_lag;
+                    max_lag = std::max(max_lag, entry.consumer_lag);
+                }
+                fetchq += entry.fetchq_cnt;
+                stats->partitions.push_back(std::move(entry));
+            }
+        }
+    }
+    if (batches > 0) {
+        stats->batch_size_avg = static_cast<double>(batch_bytes) / static_cast<double>(batches);
+        stats->batch_cnt_avg = static_cast<double>(batch_msgs) / static_cast<double>(batches);
+    }
+
+    total_consumer_lag_.store(total_lag, std::memory_order_relaxed);
+    max_consumer_lag_.store(max_lag, std::memory_order_relaxed);
+    fetch_queue_messages_.store(fetchq, std::memory_order_relaxed);
+    max_broker_rtt_us_.store(max_rtt, std::memory_order_relaxed);
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        snapshot_ = std::move(stats);
+    }
+    updates_.fetch_add(1, std::memory_order_relaxed);
+}
+
+std::shared_ptr<const KafkaStatsSnapshot> KafkaStatistics::snapshot() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return snapshot_;
+}
@@ -4,7 +4,9 @@
  */
 
 #include "MarketDepthProcessor.hpp"
+#include "LogThrottle.hpp"
 #include "spdlog/spdlog.h"
+#include <algorithm>
 #include <signal.h>
 #include <flatbuffers/flatbuffers.h>
 
@@ -16,19 +18,36 @@ namespace market_depth {
           , input_topic("market_depth_input")
           , consumer_poll_timeout_ms(100)
           , num_partitions(8)
+          , enable_partition_workers(false)
+          , enable_delta_processing(false)
+          , default_verification(InputVerification::Trusted)
+          , verifier_max_depth(64)
+          , verifier_max_tables(1000000)
+          , enable_conflation(true)
+          , catchup_publish_interval_ms(1000)
+          , backpressure_high_watermark(0.8)
+          , backpressure_low_watermark(0.5)
           , depth_levels({5, 10, 25, 50})
-          , flush_interval_ms(1000)
+          , max_price_levels(kDefaultMaxPriceLevels)
+          , suppress_unchanged_depths(true)
+          , depth_heartbeat_ms(5000)
           , enable_statistics(true)
-          , stats_report_interval_s(30) {
+          , stats_report_interval_s(30)
+          , top_symbols_capacity(1024)
+          , enable_metrics_endpoint(false)
+          , metrics_port(8080)
+          , slow_message_threshold_us(0)
+          , flight_recorder_size(1024) {
     }
 
     MarketDepthProcessor::MarketDepthProcessor(const ProcessorConfig &config)
         : config_(config)
+          , max_depth_(0)
           , running_(false)
           , should_stop_(false)
-          , last_flush_time_(std::chrono::high_resolution_clock::now()) {
-        SPDLOG_INFO("MarketDepthProcessor created with config: input_topic={}, partitions={}, depth_levels=[{}]",
-                    config_.input_topic, config_.num_partitions,
+          , flight_dump_requested_(false) {
+        SPDLOG_INFO("MarketDepthProcessor created with config: input_topic={}, partitions={}, partition_workers={}, depth_levels=[{}]",
+                    config_.input_topic, config_.num_partitions, config_.enable_partition_workers,
                     [&]() {
                         std::string levels;
                         for (size_t i = 0; i < config_.depth_levels.size(); ++i) {
@@ -37,6 +56,12 @@ namespace market_depth {
                         }
                         return levels;
                     }());
+
+        // Every depth is served from one ladder converted up to the deepest level
+        for (uint32_t depth : config_.depth_levels) {
+            max_depth_ = std::max(max_depth_, depth);
+        }
+        max_depth_ = std::min(max_depth_, config_.max_price_levels);
     }
 
     MarketDepthProcessor::~MarketDepthProcessor() {
@@ -50,6 +75,9 @@ namespace market_depth {
             // Initialize Kafka consumer
             KafkaConsumer &consumer = KafkaConsumer::instance();
             consumer.initialize(config_.kafka_config_path);
+            if (config_.enable_partition_workers && config_.num_partitions > 0) {
+                consumer.enable_partition_queues(static_cast<size_t>(config_.num_partitions));
+            }
             consumer.subscribe({config_.input_topic});
 
             // Initialize Kafka producer
@@ -59,6 +87,16 @@ namespace market_depth {
             // Initialize message factory and router
             message_factory_ = std::make_unique<MessageFactory>(config_.json_config);
             message_router_ = std::make_unique<MessageRouter>(config_.topic_config);
+            symbols_ = std::make_unique<SymbolTable>(config_.topic_config.snapshot_topic_prefix, *message_router_);
+            top_symbols_ = std::make_unique<SymbolHeavyHitters>(config_.top_symbols_capacity);
+            if (config_.slow_message_threshold_us > 0) {
+                flight_recorder_ = std::make_unique<FlightRecorder>(config_.flight_recorder_size);
+            }
+
+            // Live order books are only kept when DeltaBatch input is processed
+            if (config_.enable_delta_processing) {
+                order_books_ = std::make_unique<OrderBookManager>(message_factory_->default_exchanges());
+            }
 
             // Reset metrics
             metrics_.reset();
@@ -87,6 +125,21 @@ namespace market_depth {
             stats_thread_ = std::thread(&MarketDepthProcessor::stats_thread, this);
         }
 
+        // Metrics endpoint is best effort: processing continues if the port is taken
+        if (config_.enable_metrics_endpoint) {
+            metrics_server_ = std::make_unique<MetricsServer>(
+                config_.metrics_port, [this](std::string &out) { write_prometheus_metrics(out); });
+            if (!metrics_server_->start()) {
+                metrics_server_.reset();
+            }
+        }
+
+        // Start one worker per partition queue (consumer queue stays on this thread)
+        KafkaConsumer &consumer = KafkaConsumer::instance();
+        for (size_t i = 0; i < consumer.partition_queue_count(); ++i) {
+            worker_threads_.emplace_back(&MarketDepthProcessor::partition_worker_loop, this, i);
+        }
+
         // Start main processing
         auto start_time = std::chrono::steady_clock::now();
         processing_loop();
@@ -112,6 +165,16 @@ namespace market_depth {
         if (stats_thread_.joinable()) {
             stats_thread_.join();
         }
+        if (metrics_server_) {
+            metrics_server_->stop();
+            metrics_server_.reset();
+        }
+        for (auto &worker : worker_threads_) {
+            if (worker.joinable()) {
+                worker.join();
+            }
+        }
+        worker_threads_.clear();
 
         running_ = false;
 
@@ -125,186 +188,778 @@ namespace market_depth {
 
     void MarketDepthProcessor::processing_loop() {
         KafkaConsumer &consumer = KafkaConsumer::instance();
+        std::vector<rd_kafka_message_t *> batch(consumer.max_poll_records());
 
         while (!should_stop_) {
-            // Poll for message from any partition
-            rd_kafka_message_t *msg = consumer.consume(config_.consumer_poll_timeout_ms);
+            // Drain a batch from any partition not split onto a worker queue
+            size_t count = consumer.consume_batch(batch.data(), batch.size(), config_.consumer_poll_timeout_ms);
+            if (count > 0) {
+                handle_batch(batch.data(), count);
+            }
+
+            // Delivery reports are served by the producer service thread, never here
+            apply_backpressure();
+
+            if (flight_dump_requested_.load(std::memory_order_relaxed) && flight_dump_requested_.exchange(false)) {
+                dump_flight_recorder();
+            }
+        }
+
+        flush_catchup_windows();
+        top_symbols_->flush();
+    }
+
+    void MarketDepthProcessor::apply_backpressure() {
+        KafkaProducer &producer = KafkaProducer::instance();
+        KafkaConsumer &consumer = KafkaConsumer::instance();
+
+        const size_t capacity = producer.queue_capacity();
+        if (capacity == 0) return;
 
-            if (!msg) {
-                // No message available, continue polling
+        const size_t depth = producer.queue_depth();
+        const bool retries_pending = producer.retry_pending() > 0;
+        const double fill = static_cast<double>(depth) / static_cast<double>(capacity);
+
+        if (!consumer.is_paused()) {
+            if (fill >= config_.backpressure_high_watermark || retries_pending) {
+                if (consumer.pause_assignment()) {
+                    metrics_.input_pauses++;
+                    SPDLOG_WARN("Backpressure: producer queue at {}/{} ({} parked), input paused",
+                                depth, capacity, producer.retry_pending());
+                }
+            }
+        } else if (fill <= config_.backpressure_low_watermark && !retries_pending) {
+            if (consumer.resume_assignment()) {
+                SPDLOG_INFO("Backpressure: producer queue drained to {}/{}, input resumed", depth, capacity);
+            }
+        }
+    }
+
+    void MarketDepthProcessor::partition_worker_loop(size_t queue_index) {
+        KafkaConsumer &consumer = KafkaConsumer::instance();
+        std::vector<rd_kafka_message_t *> batch(consumer.max_poll_records());
+        SPDLOG_INFO("Partition worker {} started", queue_index);
+
+        while (!should_stop_) {
+            size_t count = consumer.consume_partition_batch(queue_index, batch.data(), batch.size(),
+                                                            config_.consumer_poll_timeout_ms);
+            if (count > 0) {
+                handle_batch(batch.data(), count);
+            }
+        }
+
+        flush_catchup_windows();
+        top_symbols_->flush();
+        SPDLOG_INFO("Partition worker {} stopped", queue_index);
+    }
+
+    void MarketDepthProcessor::handle_batch(rd_kafka_message_t **messages, size_t count) {
+        uint64_t consumed = 0;
+        uint64_t processed = 0;
+        uint64_t errors = 0;
+        uint64_t kafka_errors = 0;
+
+        // Partitions far behind their head hold output back and publish only the latest per symbol
+        CatchUpState &catchup = catchup_.local();
+        thread_local std::vector<CatchUpWindow *> window_of;
+        if (update_catchup_windows(catchup, messages, count, window_of)) {
+            metrics_.catchup_batches++;
+        }
+
+        // Untrusted payloads are verified before anything (conflation included) reads them
+        thread_local std::vector<uint8_t> drop;
+        drop.assign(count, kKeep);
+        size_t rejected = verify_batch(messages, count, drop);
+
+        // Under backlog only the newest snapshot per symbol is worth rendering
+        size_t conflated = conflate_batch(messages, count, drop, config_.enable_conflation ? nullptr : &window_of);
+
+        // Input Kafka timestamps are compared against one wall-clock reading per batch
+        IngestContext &ingest = ingest_context();
+        const uint64_t consumed_us = latency_wall_clock_us();
+
+        MessageTrace &trace = message_trace();
+        const uint64_t slow_threshold_ns = flight_recorder_ ? uint64_t(config_.slow_message_threshold_us) * 1000 : UINT64_MAX;
+
+        for (size_t i = 0; i < count; ++i) {
+            rd_kafka_message_t *msg = messages[i];
+
+            if (drop[i] != kKeep) {
+                consumed++;
+                rd_kafka_message_destroy(msg);
                 continue;
             }
 
             if (msg->err) {
                 if (msg->err != RD_KAFKA_RESP_ERR__PARTITION_EOF) {
-                    SPDLOG_ERROR("Kafka consume error: {}", rd_kafka_err2str(msg->err));
-                    metrics_.kafka_errors++;
+                    MD_ERROR_RATE_LIMITED(10, "Kafka consume error: {}", rd_kafka_err2str(msg->err));
+                    kafka_errors++;
                 }
                 rd_kafka_message_destroy(msg);
                 continue;
             }
 
-            // Process the message
-            auto start_time = get_timestamp();
-            bool success = process_message(msg);
-            auto processing_time = get_timestamp() - start_time;
+            rd_kafka_timestamp_type_t timestamp_type;
+            const int64_t timestamp_ms = rd_kafka_message_timestamp(msg, &timestamp_type);
+            ingest.timestamp_us = timestamp_ms > 0 ? static_cast<uint64_t>(timestamp_ms) * 1000 : 0;
+            ingest.partition = msg->partition;
+            if (ingest.timestamp_us != 0) {
+                consume_latency_.record(msg->partition, wall_latency_ns(ingest.timestamp_us, consumed_us));
+            }
 
-            // Update metrics
-            metrics_.messages_consumed++;
+            // Process the message (snapshots without live books are parked while catching up)
+            trace = MessageTrace{};
+            catchup.current = window_of[i];
+            const uint64_t start_ns = latency_now_ns();
+            bool success = (catchup.current && !order_books_ && park_snapshot(msg, *catchup.current)) ||
+                           process_message(msg);
+            const uint64_t elapsed_ns = latency_now_ns() - start_ns;
+
+            consumed++;
             if (success) {
-                metrics_.messages_processed++;
-                metrics_.update_processing_time(processing_time);
+                processed++;
+                record_stage(LatencyStage::Message, elapsed_ns);
             } else {
-                metrics_.processing_errors++;
+                errors++;
+            }
+            if (elapsed_ns >= slow_threshold_ns) {
+                record_slow_message(msg, elapsed_ns);
             }
 
             // Clean up
             rd_kafka_message_destroy(msg);
+        }
+        ingest = IngestContext{};
+        catchup.current = nullptr;
+
+        // Update metrics once per batch
+        metrics_.messages_consumed += consumed;
+        metrics_.messages_processed += processed;
+        if (errors > 0) {
+            metrics_.processing_errors += errors;
+        }
+        if (kafka_errors > 0) {
+            metrics_.kafka_errors += kafka_errors;
+        }
+        if (conflated > 0) {
+            metrics_.messages_conflated += conflated;
+        }
+        if (rejected > 0) {
+            metrics_.messages_rejected += rejected;
+        }
+
+        // Each window is published on its own interval, and closed once its partition has caught up
+        const auto now = std::chrono::steady_clock::now();
+        const auto interval = std::chrono::milliseconds(config_.catchup_publish_interval_ms);
+        for (auto &[key, window] : catchup.windows) {
+            if (window.active && (!window.lagging || now - window.opened >= interval)) {
+                flush_catchup_window(window);
+                if (window.lagging) {
+                    window.active = true;
+                    window.opened = now;
+                } else {
+                    MD_INFO_RATE_LIMITED(1, "Catch-up: partition {} lag back under threshold, resuming normal publishing",
+                                         key.partition);
+                }
+            }
+        }
+
+        top_symbols_->flush();
+    }
+
+    MarketDepthProcessor::IngestContext &MarketDepthProcessor::ingest_context() const {
+        thread_local IngestContext ingest;
+        return ingest;
+    }
+
+    MarketDepthProcessor::MessageTrace &MarketDepthProcessor::message_trace() const {
+        thread_local MessageTrace trace;
+        return trace;
+    }
+
+    void MarketDepthProcessor::record_stage(LatencyStage stage, uint64_t nanoseconds) {
+        latency_.record(stage, nanoseconds);
+        message_trace().stage_ns[static_cast<size_t>(stage)] += nanoseconds;
+    }
+
+    void MarketDepthProcessor::record_slow_message(const rd_kafka_message_t *msg, uint64_t total_ns) {
+        const MessageTrace &trace = message_trace();
+
+        SlowMessageRecord record;
+        record.wall_time_us = latency_wall_clock_us();
+        record.total_ns = total_ns;
+        std::copy(std::begin(trace.stage_ns), std::end(trace.stage_ns), record.stage_ns);
+        record.offset = msg->offset;
+        record.partition = msg->partition;
+        record.payload_bytes = static_cast<uint32_t>(msg->len);
+        record.bid_levels = trace.bid_levels;
+        record.ask_levels = trace.ask_levels;
+        record.views_published = trace.views_published;
+        if (trace.symbol != kInvalidSymbolId) {
+            record.set_symbol(symbols_->state(trace.symbol).symbol);
+        }
+        flight_recorder_->record(record);
+    }
+
+    void MarketDepthProcessor::dump_flight_recorder() const {
+        if (!flight_recorder_) {
+            SPDLOG_INFO("Flight recorder disabled (monitoring.slow_processing_threshold_us = 0)");
+            return;
+        }
+
+        auto records = flight_recorder_->snapshot();
+        SPDLOG_WARN("Flight recorder: {} slow messages (> {} us) retained of {} recorded ({} dropped)",
+                    records.size(), config_.slow_message_threshold_us, flight_recorder_->recorded(),
+                    flight_recorder_->dropped());
+        for (const auto &record : records) {
+            SPDLOG_WARN("  [{}] {} partition={} offset={} bytes={} levels={}/{} views={} total_us={:.1f} "
+                        "decode={:.1f} convert={:.1f} render={:.1f} produce={:.1f}",
+                        record.wall_time_us, record.symbol[0] ? record.symbol : "?", record.partition, record.offset,
+                        record.payload_bytes, record.bid_levels, record.ask_levels, record.views_published,
+                        record.total_ns / 1000.0,
+                        record.stage_ns[static_cast<size_t>(LatencyStage::Decode)] / 1000.0,
+                        record.stage_ns[static_cast<size_t>(LatencyStage::Convert)] / 1000.0,
+                        record.stage_ns[static_cast<size_t>(LatencyStage::Render)] / 1000.0,
+                        record.stage_ns[static_cast<size_t>(LatencyStage::Produce)] / 1000.0);
+        }
+    }
+
+    bool MarketDepthProcessor::update_catchup_windows(CatchUpState &state, rd_kafka_message_t **messages,
+                                                      size_t count, std::vector<CatchUpWindow *> &window_of) {
+        window_of.assign(count, nullptr);
+
+        KafkaConsumer &consumer = KafkaConsumer::instance();
+        const int64_t threshold = consumer.catchup_lag_threshold();
+        if (threshold <= 0) return false;
+
+        // One window lookup per run of one partition, and one lag check at the end of the run;
+        // watermarks are cached, so this is cheap
+        bool any_lagging = false;
+        const rd_kafka_message_t *previous = nullptr;
+        CatchUpWindow *window = nullptr;
+        for (size_t i = 0; i < count; ++i) {
+            const rd_kafka_message_t *msg = messages[i];
+            if (msg->err) continue;
+            if (!previous || previous->rkt != msg->rkt || previous->partition != msg->partition) {
+                window = &state.windows[PartitionKey{msg->rkt, msg->partition}];
+            }
+            previous = msg;
+            window_of[i] = window;
+
+            if (i + 1 < count && messages[i + 1]->rkt == msg->rkt && messages[i + 1]->partition == msg->partition) continue;
+            window->lagging = consumer.lag(msg) > threshold;
+            if (window->lagging) {
+                any_lagging = true;
+                if (!window->active) {
+                    window->active = true;
+                    window->opened = std::chrono::steady_clock::now();
+                    MD_INFO_RATE_LIMITED(1, "Catch-up: partition {} lag above {} messages, publishing latest book per symbol every {} ms",
+                                         msg->partition, threshold, config_.catchup_publish_interval_ms);
+                }
+            }
+        }
+
+        // Output is held back only for partitions whose window is open
+        for (size_t i = 0; i < count; ++i) {
+            if (window_of[i] && !window_of[i]->active) window_of[i] = nullptr;
+        }
+        return any_lagging;
+    }
+
+    bool MarketDepthProcessor::park_snapshot(const rd_kafka_message_t *msg, CatchUpWindow &window) {
+        if (!msg->payload || msg->len == 0) return false;
+
+        const auto *envelope = fb::GetEnvelope(msg->payload);
+        if (envelope->msg_type() != fb::BookMsg_OrderBookSnapshot) return false;
+        const auto *snapshot = envelope->msg_as_OrderBookSnapshot();
+        if (!snapshot || !snapshot->symbol()) return false;
+
+        SymbolId id = intern_symbol(snapshot->symbol());
+        if (id == kInvalidSymbolId) return false;
+
+        // Copy the payload so Kafka's fetch buffers are not pinned for the whole window
+        auto [it, inserted] = window.parked.try_emplace(id);
+        if (!inserted) {
+            metrics_.catchup_superseded++;
+        }
+        it->second.payload.assign(static_cast<const char *>(msg->payload), msg->len);
+        it->second.ingest = ingest_context();
+        return true;
+    }
+
+    void MarketDepthProcessor::flush_catchup_window(CatchUpWindow &window) {
+        window.active = false;
+
+        // Output is timed against the input message each symbol's newest state came from
+        IngestContext &ingest = ingest_context();
+        const IngestContext current = ingest;
+
+        for (const auto &[id, parked] : window.parked) {
+            ingest = parked.ingest;
+            const auto *envelope = fb::GetEnvelope(parked.payload.data());
+            process_snapshot(envelope->msg_as_OrderBookSnapshot());
+        }
+        window.parked.clear();
+
+        for (const auto &[id, book_ingest] : window.dirty_books) {
+            ingest = book_ingest;
+            SymbolState &state = symbols_->state(id);
+            publish_book(book_for(state), state);
+        }
+        window.dirty_books.clear();
+
+        ingest = current;
+    }
+
+    void MarketDepthProcessor::flush_catchup_windows() {
+        CatchUpState &state = catchup_.local();
+        for (auto &[key, window] : state.windows) {
+            flush_catchup_window(window);
+        }
+        state.windows.clear();
+    }
+
+    void MarketDepthProcessor::publish_book_or_defer(const OrderBook &book, SymbolId id) {
+        CatchUpWindow *window = catchup_.local().current;
+        if (window) {
+            window->dirty_books[id] = ingest_context();
+            return;
+        }
+        publish_book(book, symbols_->state(id));
+    }
+
+    SymbolId MarketDepthProcessor::intern_symbol(const ::flatbuffers::String *symbol) {
+        std::string_view name(symbol->c_str(), symbol->size());
+        SymbolId id = symbols_->intern(name);
+        message_trace().symbol = id;
+        if (id == kInvalidSymbolId) {
+            MD_ERROR_RATE_LIMITED(10, "Symbol table full, dropping message for symbol {}", name);
+        }
+        return id;
+    }
+
+    OrderBook &MarketDepthProcessor::book_for(SymbolState &state) {
+        OrderBook *book = state.book.load(std::memory_order_acquire);
+        if (!book) {
+            book = order_books_->get_or_create_orderbook(state.symbol);
+            state.book.store(book, std::memory_order_release);
+        }
+        return *book;
+    }
+
+    InputVerification MarketDepthProcessor::verification_mode(const rd_kafka_topic_t *rkt) const {
+        if (config_.topic_verification.empty() || !rkt) return config_.default_verification;
+
+        auto it = config_.topic_verification.find(rd_kafka_topic_name(rkt));
+        return it != config_.topic_verification.end() ? it->second : config_.default_verification;
+    }
+
+    size_t MarketDepthProcessor::verify_batch(rd_kafka_message_t **messages, size_t count,
+                                              std::vector<uint8_t> &drop) {
+        if (config_.default_verification == InputVerification::Trusted && config_.topic_verification.empty()) {
+            return 0;
+        }
+
+        ::flatbuffers::Verifier::Options options;
+        options.max_depth = config_.verifier_max_depth;
+        options.max_tables = config_.verifier_max_tables;
+
+        size_t verified = 0;
+        size_t rejected = 0;
+        auto start_time = get_timestamp();
+
+        // Batches are usually from one topic, so the mode is looked up once per topic run
+        const rd_kafka_topic_t *mode_rkt = nullptr;
+        InputVerification mode = config_.default_verification;
+
+        for (size_t i = 0; i < count; ++i) {
+            const rd_kafka_message_t *msg = messages[i];
+            if (msg->err) continue;
+            if (msg->rkt != mode_rkt) {
+                mode = verification_mode(msg->rkt);
+                mode_rkt = msg->rkt;
+            }
+            if (mode == InputVerification::Trusted) continue;
 
-            // Check for periodic flush
-            auto now = std::chrono::high_resolution_clock::now();
-            auto elapsed_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
-                now - last_flush_time_).count();
+            verified++;
+            bool valid = false;
+            if (msg->payload) {
+                ::flatbuffers::Verifier verifier(static_cast<const uint8_t *>(msg->payload), msg->len, options);
+                valid = fb::VerifyEnvelopeBuffer(verifier);
+            }
+            if (!valid) {
+                drop[i] = kRejected;
+                rejected++;
+                MD_WARN_RATE_LIMITED(10, "Rejected malformed FlatBuffers payload from {} [{}] at offset {} ({} bytes)",
+                                     rd_kafka_topic_name(msg->rkt), msg->partition, msg->offset, msg->len);
+            }
+        }
+
+        if (verified > 0) {
+            metrics_.messages_verified += verified;
+            metrics_.verify_time_us += get_timestamp() - start_time;
+        }
+        return rejected;
+    }
 
-            if (elapsed_ms >= config_.flush_interval_ms) {
-                rd_kafka_flush(KafkaProducer::instance().get_producer(), 100);
-                last_flush_time_ = now;
+    size_t MarketDepthProcessor::conflate_batch(rd_kafka_message_t **messages, size_t count,
+                                                std::vector<uint8_t> &drop,
+                                                const std::vector<CatchUpWindow *> *only) const {
+        // Symbols whose newest snapshot in this batch has already been seen (views into the payloads)
+        thread_local std::unordered_set<std::string_view> snapshotted;
+        snapshotted.clear();
+
+        size_t marked = 0;
+        for (size_t i = count; i-- > 0;) {
+            const rd_kafka_message_t *msg = messages[i];
+            if (drop[i] != kKeep || msg->err || !msg->payload || msg->len == 0) continue;
+            if (only && !(*only)[i]) continue;
+
+            const auto *envelope = fb::GetEnvelope(msg->payload);
+            const ::flatbuffers::String *symbol = nullptr;
+            bool is_snapshot = false;
+
+            switch (envelope->msg_type()) {
+                case fb::BookMsg_OrderBookSnapshot: {
+                    const auto *snapshot = envelope->msg_as_OrderBookSnapshot();
+                    symbol = snapshot ? snapshot->symbol() : nullptr;
+                    is_snapshot = true;
+                    break;
+                }
+                case fb::BookMsg_DeltaBatch: {
+                    const auto *batch = envelope->msg_as_DeltaBatch();
+                    symbol = batch ? batch->symbol() : nullptr;
+                    break;
+                }
+                default:
+                    break;
+            }
+            if (!symbol) continue;
+
+            std::string_view key(symbol->c_str(), symbol->size());
+            if (snapshotted.count(key)) {
+                drop[i] = kSuperseded;
+                ++marked;
+            } else if (is_snapshot) {
+                snapshotted.insert(key);
             }
         }
+
+        return marked;
     }
 
     bool MarketDepthProcessor::process_message(rd_kafka_message_t *msg) {
         if (!msg || !msg->payload || msg->len == 0) {
-            SPDLOG_WARN("Received empty or invalid message");
+            MD_WARN_RATE_LIMITED(10, "Received empty or invalid message");
             return false;
         }
 
         try {
+            const uint64_t decode_start = latency_now_ns();
+
             // Parse FlatBuffers message
             const uint8_t *data = static_cast<const uint8_t *>(msg->payload);
 
             // Get envelope
             const auto *envelope = fb::GetEnvelope(data);
             if (!envelope) {
-                SPDLOG_ERROR("Failed to parse FlatBuffers envelope");
+                MD_ERROR_RATE_LIMITED(10, "Failed to parse FlatBuffers envelope");
                 return false;
             }
 
-            // Check message type
-            if (envelope->msg_type() != fb::BookMsg_OrderBookSnapshot) {
-                SPDLOG_DEBUG("Ignoring non-snapshot message type: {}", static_cast<int>(envelope->msg_type()));
-                return true; // Not an error, just not what we're looking for
-            }
+            switch (envelope->msg_type()) {
+                case fb::BookMsg_OrderBookSnapshot: {
+                    const auto *snapshot = envelope->msg_as_OrderBookSnapshot();
+                    if (!snapshot) {
+                        MD_ERROR_RATE_LIMITED(10, "Failed to get OrderBookSnapshot from envelope");
+                        return false;
+                    }
+                    record_stage(LatencyStage::Decode, latency_now_ns() - decode_start);
+                    // Process snapshot directly (and re-seed the live book if enabled)
+                    return process_snapshot(snapshot);
+                }
 
-            // Get snapshot
-            const auto *snapshot = envelope->msg_as_OrderBookSnapshot();
-            if (!snapshot) {
-                SPDLOG_ERROR("Failed to get OrderBookSnapshot from envelope");
-                return false;
-            }
+                case fb::BookMsg_DeltaBatch: {
+                    if (!config_.enable_delta_processing) {
+                        MD_DEBUG_SAMPLED(1000, "Ignoring DeltaBatch message: delta processing disabled");
+                        return true; // Not an error, just not what we're looking for
+                    }
+                    const auto *batch = envelope->msg_as_DeltaBatch();
+                    if (!batch) {
+                        MD_ERROR_RATE_LIMITED(10, "Failed to get DeltaBatch from envelope");
+                        return false;
+                    }
+                    record_stage(LatencyStage::Decode, latency_now_ns() - decode_start);
+                    return process_delta_batch(batch);
+                }
 
-            // Process snapshot directly
-            return process_snapshot(snapshot);
+                default:
+                    MD_DEBUG_SAMPLED(1000, "Ignoring unknown message type: {}", static_cast<int>(envelope->msg_type()));
+                    return true;
+            }
 
         } catch (const std::exception &e) {
-            SPDLOG_ERROR("Exception processing message: {}", e.what());
+            MD_ERROR_RATE_LIMITED(10, "Exception processing message: {}", e.what());
             return false;
         }
     }
 
     bool MarketDepthProcessor::process_snapshot(const fb::OrderBookSnapshot* snapshot) {
         if (!snapshot || !snapshot->symbol()) {
-            SPDLOG_ERROR("Invalid snapshot: null or missing symbol");
+            MD_ERROR_RATE_LIMITED(10, "Invalid snapshot: null or missing symbol");
             return false;
         }
 
-        std::string symbol = snapshot->symbol()->str();
+        const SymbolId id = intern_symbol(snapshot->symbol());
+        if (id == kInvalidSymbolId) return false;
+        SymbolState &state = symbols_->state(id);
+        const std::string &symbol = state.symbol;
 
         try {
-            // Publish snapshots directly for all depth levels
-            publish_snapshots(symbol, snapshot);
+            if (order_books_) {
+                // Seed or re-seed the live book so subsequent deltas apply on top of it,
+                // then publish from its level aggregates instead of re-summing orders per depth
+                OrderBook *book = &book_for(state);
+                bool was_stale = book->sequencer().state() == SymbolSequencer::State::Stale;
+                if (book->sequencer().on_snapshot(snapshot->seq()) == SymbolSequencer::Result::Duplicate) {
+                    metrics_.duplicates_dropped++;
+                    MD_DEBUG_SAMPLED(1000, "Dropping stale snapshot for symbol {} (seq {}, expected >= {})",
+                                     symbol, snapshot->seq(), book->sequencer().next_expected());
+                    return true;
+                }
+                if (was_stale) {
+                    metrics_.stale_symbols--;
+                    MD_INFO_RATE_LIMITED(10, "Symbol {} resynchronised from snapshot (seq {})", symbol, snapshot->seq());
+                }
+                book->apply_snapshot(snapshot);
+                publish_book_or_defer(*book, id);
+            } else {
+                // Publish snapshots directly for all depth levels
+                publish_snapshots(state, snapshot);
+            }
 
-            // Update symbol-specific metrics
-            metrics_.symbol_message_counts[symbol]++;
+            top_symbols_->count(id);
 
             SPDLOG_TRACE("Processed snapshot for symbol: {} (seq: {})", symbol, snapshot->seq());
             return true;
 
         } catch (const std::exception &e) {
-            SPDLOG_ERROR("Failed to process snapshot for symbol {}: {}", symbol, e.what());
+            MD_ERROR_RATE_LIMITED(10, "Failed to process snapshot for symbol {}: {}", symbol, e.what());
+            return false;
+        }
+    }
+
+    bool MarketDepthProcessor::process_delta_batch(const fb::DeltaBatch* batch) {
+        if (!batch || !batch->symbol()) {
+            MD_ERROR_RATE_LIMITED(10, "Invalid delta batch: null or missing symbol");
+            return false;
+        }
+
+        const SymbolId id = intern_symbol(batch->symbol());
+        if (id == kInvalidSymbolId) return false;
+        SymbolState &state = symbols_->state(id);
+        const std::string &symbol = state.symbol;
+
+        try {
+            OrderBook *book = &book_for(state);
+            SymbolSequencer& sequencer = book->sequencer();
+            uint64_t first_new_seq = sequencer.next_expected();
+
+            switch (sequencer.on_batch(batch->seq_start(), batch->seq_end())) {
+                case SymbolSequencer::Result::Apply:
+                    break;
+
+                case SymbolSequencer::Result::Duplicate:
+                    metrics_.duplicates_dropped++;
+                    MD_DEBUG_SAMPLED(1000, "Dropping duplicate delta batch for symbol {} (seq {}-{}, expected {})",
+                                     symbol, batch->seq_start(), batch->seq_end(), first_new_seq);
+                    return true;
+
+                case SymbolSequencer::Result::Gap:
+                    // Book can no longer be trusted: hold its output until a snapshot re-seeds it
+                    metrics_.sequence_gaps++;
+                    metrics_.stale_symbols++;
+                    metrics_.delta_batches_dropped++;
+                    MD_WARN_RATE_LIMITED(10, "Sequence gap for symbol {}: expected {}, got {}-{}; holding until next snapshot",
+                                         symbol, first_new_seq, batch->seq_start(), batch->seq_end());
+                    return true;
+
+                case SymbolSequencer::Result::Held:
+                    // Deltas are meaningless until a snapshot has (re-)seeded the book
+                    metrics_.delta_batches_dropped++;
+                    MD_DEBUG_SAMPLED(1000, "Dropping delta batch for unseeded/stale symbol {} (seq {}-{})",
+                                     symbol, batch->seq_start(), batch->seq_end());
+                    return true;
+            }
+
+            metrics_.deltas_applied += book->apply_delta_batch(batch, first_new_seq);
+
+            // Publish depth views from the live book
+            publish_book_or_defer(*book, id);
+
+            top_symbols_->count(id);
+
+            SPDLOG_TRACE("Applied delta batch for symbol: {} (seq: {}-{})", symbol, batch->seq_start(), batch->seq_end());
+            return true;
+
+        } catch (const std::exception &e) {
+            MD_ERROR_RATE_LIMITED(10, "Failed to apply delta batch for symbol {}: {}", symbol, e.what());
             return false;
         }
     }
 
-    void MarketDepthProcessor::publish_snapshots(const std::string& symbol, const fb::OrderBookSnapshot* snapshot) {
+    void MarketDepthProcessor::publish_snapshots(SymbolState& state, const fb::OrderBookSnapshot* snapshot) {
+        const std::string& symbol = state.symbol;
         try {
-            // Convert FlatBuffers snapshot to internal format for each depth level
-            for (uint32_t depth : config_.depth_levels) {
-                // Create internal snapshot structure
-                InternalOrderBookSnapshot internal_snapshot;
-                internal_snapshot.symbol = symbol;
-                internal_snapshot.sequence = snapshot->seq();
-                internal_snapshot.timestamp = get_timestamp();
-                internal_snapshot.last_trade_price = snapshot->recent_trade_price();
-                internal_snapshot.last_trade_quantity = snapshot->recent_trade_qty();
-
-                // Convert bid levels (limited by depth)
-                if (snapshot->buy_side()) {
-                    uint32_t bid_count = 0;
-                    for (uint32_t i = 0; i < snapshot->buy_side()->size() && bid_count < depth; ++i) {
-                        const auto* fb_level = snapshot->buy_side()->Get(i);
-                        if (fb_level) {
-                            PriceLevel level = convert_price_level(fb_level);
-                            if (level.price > 0 && level.quantity > 0) {
-                                internal_snapshot.bid_levels[level.price] = level;
-                                bid_count++;
-                            }
+            // Convert the FlatBuffers snapshot once, up to the deepest configured level
+            const uint64_t convert_start = latency_now_ns();
+            InternalOrderBookSnapshot& internal_snapshot = scratch_snapshot();
+            internal_snapshot.symbol = symbol;
+            internal_snapshot.sequence = snapshot->seq();
+            internal_snapshot.timestamp = get_timestamp();
+            internal_snapshot.ingest_timestamp_us = ingest_context().timestamp_us;
+            internal_snapshot.source_partition = ingest_context().partition;
+            internal_snapshot.last_trade_price = snapshot->recent_trade_price();
+            internal_snapshot.last_trade_quantity = snapshot->recent_trade_qty();
+
+            // Convert bid levels (limited by max depth)
+            if (snapshot->buy_side()) {
+                uint32_t bid_count = 0;
+                for (uint32_t i = 0; i < snapshot->buy_side()->size() && bid_count < max_depth_; ++i) {
+                    const auto* fb_level = snapshot->buy_side()->Get(i);
+                    if (fb_level) {
+                        PriceLevel level = convert_price_level(fb_level);
+                        if (level.price > 0 && level.quantity > 0 &&
+                            internal_snapshot.bid_levels.insert(level.price, level.quantity, level.num_orders, level.exchanges)) {
+                            bid_count++;
                         }
                     }
                 }
+            }
 
-                // Convert ask levels (limited by depth)
-                if (snapshot->sell_side()) {
-                    uint32_t ask_count = 0;
-                    for (uint32_t i = 0; i < snapshot->sell_side()->size() && ask_count < depth; ++i) {
-                        const auto* fb_level = snapshot->sell_side()->Get(i);
-                        if (fb_level) {
-                            PriceLevel level = convert_price_level(fb_level);
-                            if (level.price > 0 && level.quantity > 0) {
-                                internal_snapshot.ask_levels[level.price] = level;
-                                ask_count++;
-                            }
+            // Convert ask levels (limited by max depth)
+            if (snapshot->sell_side()) {
+                uint32_t ask_count = 0;
+                for (uint32_t i = 0; i < snapshot->sell_side()->size() && ask_count < max_depth_; ++i) {
+                    const auto* fb_level = snapshot->sell_side()->Get(i);
+                    if (fb_level) {
+                        PriceLevel level = convert_price_level(fb_level);
+                        if (level.price > 0 && level.quantity > 0 &&
+                            internal_snapshot.ask_levels.insert(level.price, level.quantity, level.num_orders, level.exchanges)) {
+                            ask_count++;
                         }
                     }
                 }
+            }
 
-                // Only publish if we have sufficient data
-                if (internal_snapshot.bid_levels.size() >= depth && internal_snapshot.ask_levels.size() >= depth) {
-                    // Generate JSON for this depth level
-                    std::string json_payload = message_factory_->create_snapshot_json(internal_snapshot, depth);
+            record_stage(LatencyStage::Convert, latency_now_ns() - convert_start);
+            message_trace().bid_levels = static_cast<uint32_t>(internal_snapshot.bid_levels.size());
+            message_trace().ask_levels = static_cast<uint32_t>(internal_snapshot.ask_levels.size());
 
-                    // Create topic name: market_depth.[SYMBOL_NAME]
-                    std::string topic = "market_depth." + symbol;
+            // Each depth is a view over the same ladder
+            publish_depths(internal_snapshot, state);
 
-                    // Use symbol for partitioning
-                    uint32_t partition = message_router_->calculate_partition(symbol);
+        } catch (const std::exception &e) {
+            MD_ERROR_RATE_LIMITED(10, "Failed to publish snapshots for symbol {}: {}", symbol, e.what());
+            metrics_.processing_errors++;
+        }
+    }
 
-                    // Publish to Kafka
-                    KafkaPush(topic, partition, json_payload.c_str(), json_payload.size());
-                    metrics_.messages_published++;
+    void MarketDepthProcessor::publish_book(const OrderBook& book, SymbolState& state) {
+        try {
+            const uint64_t convert_start = latency_now_ns();
+            InternalOrderBookSnapshot& internal_snapshot = scratch_snapshot();
+            book.fill_snapshot(internal_snapshot, max_depth_);
+            internal_snapshot.timestamp = get_timestamp();
+            internal_snapshot.ingest_timestamp_us = ingest_context().timestamp_us;
+            internal_snapshot.source_partition = ingest_context().partition;
+            record_stage(LatencyStage::Convert, latency_now_ns() - convert_start);
+            message_trace().bid_levels = static_cast<uint32_t>(internal_snapshot.bid_levels.size());
+            message_trace().ask_levels = static_cast<uint32_t>(internal_snapshot.ask_levels.size());
+
+            publish_depths(internal_snapshot, state);
+        } catch (const std::exception &e) {
+            MD_ERROR_RATE_LIMITED(10, "Failed to publish book for symbol {}: {}", book.get_symbol(), e.what());
+            metrics_.processing_errors++;
+        }
+    }
 
-                    SPDLOG_TRACE("Published depth {} for symbol {} to topic {} partition {}",
-                                depth, symbol, topic, partition);
-                } else {
-                    SPDLOG_DEBUG("Insufficient depth for symbol {}: requested={}, available_bids={}, available_asks={}",
-                                symbol, depth, internal_snapshot.bid_levels.size(), internal_snapshot.ask_levels.size());
+    void MarketDepthProcessor::publish_depths(const InternalOrderBookSnapshot& internal_snapshot, SymbolState& state) {
+        for (size_t i = 0; i < config_.depth_levels.size(); ++i) {
+            publish_depth(internal_snapshot, config_.depth_levels[i], state, i);
+        }
+    }
+
+    void MarketDepthProcessor::publish_depth(const InternalOrderBookSnapshot& internal_snapshot, uint32_t depth,
+                                             SymbolState& state, size_t view_index) {
+        // Only publish if we have sufficient data
+        if (internal_snapshot.bid_levels.size() >= depth && internal_snapshot.ask_levels.size() >= depth) {
+            // Skip the view if its top levels are unchanged since it was last published
+            SymbolState::DepthView *view = nullptr;
+            uint64_t fingerprint = 0;
+            if (config_.suppress_unchanged_depths && view_index < SymbolState::kMaxDepthViews) {
+                view = &state.depth_views[view_index];
+                fingerprint = internal_snapshot.depth_fingerprint(depth);
+                const bool heartbeat_due = config_.depth_heartbeat_ms > 0 &&
+                    internal_snapshot.timestamp - view->published_us >= uint64_t(config_.depth_heartbeat_ms) * 1000;
+                if (view->published_us != 0 && view->fingerprint == fingerprint && !heartbeat_due) {
+                    metrics_.depth_views_suppressed++;
+                    return;
                 }
             }
 
-        } catch (const std::exception &e) {
-            SPDLOG_ERROR("Failed to publish snapshots for symbol {}: {}", symbol, e.what());
-            metrics_.processing_errors++;
+            // Render JSON for this depth level straight into a pooled buffer; librdkafka
+            // sends it without copying and the delivery report returns it to the pool
+            const uint64_t render_start = latency_now_ns();
+            OutputBuffer *payload = KafkaProducer::instance().buffer_pool().acquire();
+            message_factory_->write_snapshot_json(internal_snapshot, depth, payload->data);
+            payload->ingest_timestamp_us = internal_snapshot.ingest_timestamp_us;
+            payload->source_partition = internal_snapshot.source_partition;
+            const uint64_t produce_start = latency_now_ns();
+            record_stage(LatencyStage::Render, produce_start - render_start);
+
+            // Topic (market_depth.[SYMBOL_NAME]) and partition were resolved when the symbol was interned
+            rd_kafka_topic_t *topic = state.topic.load(std::memory_order_acquire);
+            if (!topic) {
+                topic = KafkaProducer::instance().get_or_create_topic(state.topic_name);
+                state.topic.store(topic, std::memory_order_release);
+            }
+
+            // Publish to Kafka (buffer ownership passes to the producer)
+            const bool pushed = KafkaPushBuffer(topic, static_cast<int>(state.partition), payload);
+            record_stage(LatencyStage::Produce, latency_now_ns() - produce_start);
+            if (pushed) {
+                metrics_.messages_published++;
+                message_trace().views_published++;
+                if (internal_snapshot.ingest_timestamp_us != 0) {
+                    enqueue_latency_.record(internal_snapshot.source_partition,
+                                            wall_latency_ns(internal_snapshot.ingest_timestamp_us, latency_wall_clock_us()));
+                }
+                if (view) {
+                    view->fingerprint = fingerprint;
+                    view->published_us = internal_snapshot.timestamp;
+                }
+            } else {
+                metrics_.kafka_errors++;
+            }
+
+            SPDLOG_TRACE("Published depth {} for symbol {} to topic {} partition {}",
+                        depth, state.symbol, state.topic_name, state.partition);
+        } else {
+            MD_DEBUG_SAMPLED(1000, "Insufficient depth for symbol {}: requested={}, available_bids={}, available_asks={}",
+                        state.symbol, depth, internal_snapshot.bid_levels.size(), internal_snapshot.ask_levels.size());
+        }
+    }
+
+    InternalOrderBookSnapshot& MarketDepthProcessor::scratch_snapshot() const {
+        // One snapshot per thread, sized once from max_price_levels and reused for every message
+        thread_local InternalOrderBookSnapshot snapshot(0);
+        if (snapshot.bid_levels.capacity() != config_.max_price_levels) {
+            snapshot.bid_levels.set_capacity(config_.max_price_levels);
+            snapshot.ask_levels.set_capacity(config_.max_price_levels);
         }
+        snapshot.clear();
+        return snapshot;
     }
 
     PriceLevel MarketDepthProcessor::convert_price_level(const fb::OrderMsgLevel* fb_level) const {
@@ -312,7 +967,7 @@ namespace market_depth {
         level.price = fb_level->price();
         level.quantity = 0;
         level.num_orders = 0;
-        level.exchanges.push_back(config_.json_config.exchange_name);
+        level.exchanges = message_factory_->default_exchanges();  // Single-venue feed
 
         // Aggregate orders at this price level
         if (fb_level->orders()) {
@@ -347,12 +1002,21 @@ namespace market_depth {
         copy.messages_published = metrics_.messages_published.load();
         copy.processing_errors = metrics_.processing_errors.load();
         copy.kafka_errors = metrics_.kafka_errors.load();
-        copy.total_processing_time_us = metrics_.total_processing_time_us.load();
-        copy.max_processing_time_us = metrics_.max_processing_time_us.load();
-        copy.min_processing_time_us = metrics_.min_processing_time_us.load();
+        copy.deltas_applied = metrics_.deltas_applied.load();
+        copy.delta_batches_dropped = metrics_.delta_batches_dropped.load();
+        copy.duplicates_dropped = metrics_.duplicates_dropped.load();
+        copy.sequence_gaps = metrics_.sequence_gaps.load();
+        copy.stale_symbols = metrics_.stale_symbols.load();
+        copy.input_pauses = metrics_.input_pauses.load();
+        copy.messages_conflated = metrics_.messages_conflated.load();
+        copy.catchup_batches = metrics_.catchup_batches.load();
+        copy.catchup_superseded = metrics_.catchup_superseded.load();
+        copy.depth_views_suppressed = metrics_.depth_views_suppressed.load();
+        copy.messages_verified = metrics_.messages_verified.load();
+        copy.messages_rejected = metrics_.messages_rejected.load();
+        copy.verify_time_us = metrics_.verify_time_us.load();
         copy.start_time = metrics_.start_time;
         copy.last_stats_time = metrics_.last_stats_time;
-        // Note: symbol_message_counts is complex to copy safely, skip for now
         return copy;
     }
 
@@ -367,36 +1031,244 @@ namespace market_depth {
         uint64_t errors = metrics_.processing_errors.load();
         uint64_t kafka_errors = metrics_.kafka_errors.load();
 
-        uint64_t total_processing_time = metrics_.total_processing_time_us.load();
-        uint64_t max_processing_time = metrics_.max_processing_time_us.load();
-        uint64_t min_processing_time = metrics_.min_processing_time_us.load();
-
-        double avg_processing_time_us = processed > 0 ? static_cast<double>(total_processing_time) / processed : 0.0;
         double msg_rate = total_runtime_s > 0 ? static_cast<double>(consumed) / total_runtime_s : 0.0;
 
         SPDLOG_INFO("=== SIMPLIFIED PROCESSOR STATISTICS ({}s runtime) ===", total_runtime_s);
-        SPDLOG_INFO("Messages: consumed={}, processed={}, published={}", consumed, processed, published);
+        SPDLOG_INFO("Messages: consumed={}, processed={}, published={}, conflated={}",
+                    consumed, processed, published, metrics_.messages_conflated.load());
         SPDLOG_INFO("Errors: processing={}, kafka={}", errors, kafka_errors);
+        if (order_books_) {
+            SPDLOG_INFO("Order books: tracked={}, deltas_applied={}, delta_batches_dropped={}",
+                        order_books_->size(), metrics_.deltas_applied.load(), metrics_.delta_batches_dropped.load());
+            SPDLOG_INFO("Sequencing: gaps={}, duplicates_dropped={}, stale_symbols={}",
+                        metrics_.sequence_gaps.load(), metrics_.duplicates_dropped.load(), metrics_.stale_symbols.load());
+        }
+        DeliveryStats delivery = KafkaProducer::instance().delivery_stats();
+        SPDLOG_INFO("Delivery: delivered={}, failed={}, buffers_in_flight={}",
+                    delivery.delivered, delivery.failed, KafkaProducer::instance().buffer_pool().outstanding());
+        SPDLOG_INFO("Depth views: suppressed_unchanged={}", metrics_.depth_views_suppressed.load());
+        uint64_t verified = metrics_.messages_verified.load();
+        SPDLOG_INFO("Verification: verified={}, rejected={}, avg_verify_ns={:.0f}",
+                    verified, metrics_.messages_rejected.load(),
+                    verified > 0 ? static_cast<double>(metrics_.verify_time_us.load()) * 1000.0 / verified : 0.0);
+        SPDLOG_INFO("Catch-up: batches={}, superseded={}",
+                    metrics_.catchup_batches.load(), metrics_.catchup_superseded.load());
+        SPDLOG_INFO("Backpressure: input_pauses={}, paused={}, parked={}, dropped={}, queue_depth={}",
+                    metrics_.input_pauses.load(), KafkaConsumer::instance().is_paused(),
+                    delivery.parked, delivery.dropped, KafkaProducer::instance().queue_depth());
         SPDLOG_INFO("Rate: {:.1f} msg/s", msg_rate);
-        SPDLOG_INFO("Processing time (μs): avg={:.1f}, min={}, max={}",
-                    avg_processing_time_us, min_processing_time, max_processing_time);
 
-        // Active symbols count
-        SPDLOG_INFO("Active symbols: {}", metrics_.symbol_message_counts.size());
+        // Per-stage latency percentiles, merged across worker threads
+        auto log_latency = [](const char *stage, const LatencyDistribution &latency) {
+            SPDLOG_INFO("Latency {:<8} (μs): count={}, p50={:.1f}, p99={:.1f}, p99.9={:.1f}, max={:.1f}",
+                        stage, latency.count(),
+                        latency.percentile(0.50) / 1000.0, latency.percentile(0.99) / 1000.0,
+                        latency.percentile(0.999) / 1000.0, latency.max() / 1000.0);
+        };
+        for (size_t i = 0; i < kLatencyStageCount; ++i) {
+            const auto stage = static_cast<LatencyStage>(i);
+            log_latency(latency_stage_name(stage), latency_.collect(stage));
+        }
+        LatencyDistribution delivery_latency;
+        delivery_latency.add(KafkaProducer::instance().delivery_latency());
+        log_latency("delivery", delivery_latency);
+
+        // End-to-end from the input Kafka timestamp, per input partition: consumed / enqueued / delivered
+        const PartitionLatencyRecorder &delivered_latency = KafkaProducer::instance().ingest_delivery_latency();
+        const int32_t partition_limit = std::max({consume_latency_.partition_limit(), enqueue_latency_.partition_limit(),
+                                                  delivered_latency.partition_limit()});
+        for (int32_t partition = 0; partition < partition_limit; ++partition) {
+            LatencyDistribution consumed = consume_latency_.collect(partition);
+            if (consumed.count() == 0) continue;
+            LatencyDistribution enqueued = enqueue_latency_.collect(partition);
+            LatencyDistribution delivered = delivered_latency.collect(partition);
+            SPDLOG_INFO("End-to-end partition {} (ms p50/p99/max): consumed={:.1f}/{:.1f}/{:.1f}, "
+                        "enqueued={:.1f}/{:.1f}/{:.1f}, delivered={:.1f}/{:.1f}/{:.1f}",
+                        partition,
+                        consumed.percentile(0.50) / 1e6, consumed.percentile(0.99) / 1e6, consumed.max() / 1e6,
+                        enqueued.percentile(0.50) / 1e6, enqueued.percentile(0.99) / 1e6, enqueued.max() / 1e6,
+                        delivered.percentile(0.50) / 1e6, delivered.percentile(0.99) / 1e6, delivered.max() / 1e6);
+        }
+
+        // librdkafka statistics (when enabled): brokers for both clients, partitions for the consumer
+        auto log_kafka_statistics = [](const char *client, const KafkaStatistics &statistics) {
+            auto stats = statistics.snapshot();
+            if (!stats) return;
+            for (const auto &broker : stats->brokers) {
+                SPDLOG_INFO("Kafka {} broker {}: state={}, rtt_ms avg={:.1f} p99={:.1f}, outbuf={}, waitresp={}, errors tx={} rx={}",
+                            client, broker.name, broker.state, broker.rtt_avg_us / 1000.0, broker.rtt_p99_us / 1000.0,
+                            broker.outbuf_cnt, broker.waitresp_cnt, broker.tx_errors, broker.rx_errors);
+            }
+            for (const auto &partition : stats->partitions) {
+                SPDLOG_INFO("Kafka {} partition {}[{}]: lag={}, committed={}, high={}, fetchq={} msgs/{} bytes",
+                            client, partition.topic, partition.partition, partition.consumer_lag,
+                            partition.committed_offset, partition.hi_offset, partition.fetchq_cnt, partition.fetchq_size);
+            }
+        };
+        log_kafka_statistics("consumer", KafkaConsumer::instance().statistics());
+        log_kafka_statistics("producer", KafkaProducer::instance().statistics());
+        if (auto producer_stats = KafkaProducer::instance().statistics().snapshot()) {
+            SPDLOG_INFO("Kafka producer: queued={} msgs/{} bytes, batch avg={:.0f} bytes/{:.1f} msgs",
+                        producer_stats->msg_cnt, producer_stats->msg_size,
+                        producer_stats->batch_size_avg, producer_stats->batch_cnt_avg);
+        }
 
-        // Top 10 symbols by message count
-        std::vector<std::pair<std::string, uint64_t>> symbol_stats;
-        for (const auto& [symbol, count] : metrics_.symbol_message_counts) {
-            symbol_stats.emplace_back(symbol, count.load());
+        // Active symbols count
+        SPDLOG_INFO("Active symbols: {}", symbols_ ? symbols_->size() : 0);
+
+        // Top 10 symbols by message count, merged from the per-thread summaries
+        if (top_symbols_) {
+            SPDLOG_INFO("Top symbols by message count:");
+            for (const auto& entry : top_symbols_->top(10)) {
+                if (entry.error > 0) {
+                    SPDLOG_INFO("  {}: {} (±{})", symbols_->state(entry.id).symbol, entry.count, entry.error);
+                } else {
+                    SPDLOG_INFO("  {}: {}", symbols_->state(entry.id).symbol, entry.count);
+                }
+            }
         }
+    }
 
-        std::sort(symbol_stats.begin(), symbol_stats.end(),
-                  [](const auto& a, const auto& b) { return a.second > b.second; });
+    void MarketDepthProcessor::write_prometheus_metrics(std::string &out) const {
+        auto it = std::back_inserter(out);
+
+        auto counter = [&](const char *name, const char *help, uint64_t value) {
+            fmt::format_to(it, "# HELP md_{0} {1}\n# TYPE md_{0} counter\nmd_{0} {2}\n", name, help, value);
+        };
+        auto gauge = [&](const char *name, const char *help, double value) {
+            fmt::format_to(it, "# HELP md_{0} {1}\n# TYPE md_{0} gauge\nmd_{0} {2}\n", name, help, value);
+        };
+
+        counter("messages_consumed_total", "Messages consumed from the input topic", metrics_.messages_consumed.load());
+        counter("messages_processed_total", "Messages processed successfully", metrics_.messages_processed.load());
+        counter("messages_published_total", "Depth views published", metrics_.messages_published.load());
+        counter("processing_errors_total", "Messages that failed processing", metrics_.processing_errors.load());
+        counter("kafka_errors_total", "Consume or produce errors", metrics_.kafka_errors.load());
+        counter("messages_conflated_total", "Snapshots superseded within a batch", metrics_.messages_conflated.load());
+        counter("messages_verified_total", "Payloads run through the FlatBuffers verifier", metrics_.messages_verified.load());
+        counter("messages_rejected_total", "Payloads that failed verification", metrics_.messages_rejected.load());
+        counter("depth_views_suppressed_total", "Unchanged depth views not published", metrics_.depth_views_suppressed.load());
+        counter("deltas_applied_total", "Order deltas applied to live books", metrics_.deltas_applied.load());
+        counter("delta_batches_dropped_total", "Delta batches held for unseeded or stale books", metrics_.delta_batches_dropped.load());
+        counter("duplicates_dropped_total", "Duplicate snapshots or delta batches dropped", metrics_.duplicates_dropped.load());
+        counter("sequence_gaps_total", "Sequence gaps detected", metrics_.sequence_gaps.load());
+        counter("catchup_batches_total", "Batches consumed while catching up", metrics_.catchup_batches.load());
+        counter("catchup_superseded_total", "Snapshots replaced in the catch-up window", metrics_.catchup_superseded.load());
+        counter("input_pauses_total", "Times input was paused for producer backpressure", metrics_.input_pauses.load());
+        counter("slow_messages_total", "Messages over monitoring.slow_processing_threshold_us", flight_recorder_ ? flight_recorder_->recorded() : 0);
+        gauge("stale_symbols", "Symbols waiting for a re-seeding snapshot", static_cast<double>(metrics_.stale_symbols.load()));
+        gauge("symbols", "Interned symbols", symbols_ ? static_cast<double>(symbols_->size()) : 0.0);
+
+        KafkaProducer &producer = KafkaProducer::instance();
+        DeliveryStats delivery = producer.delivery_stats();
+        counter("delivered_total", "Messages acknowledged by the output cluster", delivery.delivered);
+        counter("delivery_failures_total", "Messages that permanently failed delivery", delivery.failed);
+        counter("retry_parked_total", "Messages parked after QUEUE_FULL", delivery.parked);
+        counter("retry_dropped_total", "Messages dropped because the retry ring was full", delivery.dropped);
+        gauge("producer_queue_depth", "Messages in the producer queue", static_cast<double>(producer.queue_depth()));
+        gauge("producer_queue_capacity", "Producer queue capacity", static_cast<double>(producer.queue_capacity()));
+        gauge("producer_retry_pending", "Messages parked in the retry ring", static_cast<double>(producer.retry_pending()));
+        gauge("buffers_in_flight", "Output buffers held by the producer", static_cast<double>(producer.buffer_pool().outstanding()));
 
-        SPDLOG_INFO("Top symbols by message count:");
-        for (size_t i = 0; i < std::min(symbol_stats.size(), size_t(10)); ++i) {
-            SPDLOG_INFO("  {}: {}", symbol_stats[i].first, symbol_stats[i].second);
+        KafkaConsumer &consumer = KafkaConsumer::instance();
+        gauge("input_paused", "1 while input is paused for backpressure", consumer.is_paused() ? 1.0 : 0.0);
+
+        out += "# HELP md_consumer_lag_messages Messages between the consume position and the high watermark\n"
+               "# TYPE md_consumer_lag_messages gauge\n";
+        for (const PartitionLag &lag : consumer.partition_lags()) {
+            if (lag.lag < 0) continue;
+            fmt::format_to(it, "md_consumer_lag_messages{{topic=\"{}\",partition=\"{}\"}} {}\n",
+                           lag.topic, lag.partition, lag.lag);
         }
+
+        // librdkafka statistics gauges (only once the first document has arrived); each family is one group
+        const std::pair<const char *, std::shared_ptr<const KafkaStatsSnapshot>> kafka_stats[] = {
+            {"consumer", consumer.statistics().snapshot()},
+            {"producer", producer.statistics().snapshot()},
+        };
+        auto broker_gauge = [&](const char *name, const char *help, auto value) {
+            fmt::format_to(it, "# HELP md_{0} {1}\n# TYPE md_{0} gauge\n", name, help);
+            for (const auto &[client, stats] : kafka_stats) {
+                if (!stats) continue;
+                for (const auto &broker : stats->brokers) {
+                    fmt::format_to(it, "md_{}{{client=\"{}\",broker=\"{}\"}} {}\n", name, client, broker.name, value(broker));
+                }
+            }
+        };
+        broker_gauge("kafka_broker_rtt_avg_seconds", "Broker request round-trip time, average",
+                     [](const KafkaBrokerStats &b) { return b.rtt_avg_us / 1e6; });
+        broker_gauge("kafka_broker_rtt_p99_seconds", "Broker request round-trip time, p99",
+                     [](const KafkaBrokerStats &b) { return b.rtt_p99_us / 1e6; });
+        broker_gauge("kafka_broker_outbuf_requests", "Requests waiting to be sent to the broker",
+                     [](const KafkaBrokerStats &b) { return b.outbuf_cnt; });
+        broker_gauge("kafka_broker_waitresp_requests", "Requests in flight to the broker",
+                     [](const KafkaBrokerStats &b) { return b.waitresp_cnt; });
+
+        auto partition_gauge = [&](const char *name, const char *help, auto value) {
+            fmt::format_to(it, "# HELP md_{0} {1}\n# TYPE md_{0} gauge\n", name, help);
+            for (const auto &[client, stats] : kafka_stats) {
+                if (!stats) continue;
+                for (const auto &partition : stats->partitions) {
+                    fmt::format_to(it, "md_{}{{client=\"{}\",topic=\"{}\",partition=\"{}\"}} {}\n",
+                                   name, client, partition.topic, partition.partition, value(partition));
+                }
+            }
+        };
+        partition_gauge("kafka_partition_lag_messages", "Consumer lag reported by librdkafka (-1 = unknown)",
+                        [](const KafkaPartitionStats &p) { return p.consumer_lag; });
+        partition_gauge("kafka_partition_fetchq_messages", "Messages pre-fetched and waiting to be consumed",
+                        [](const KafkaPartitionStats &p) { return p.fetchq_cnt; });
+        partition_gauge("kafka_partition_fetchq_bytes", "Bytes pre-fetched and waiting to be consumed",
+                        [](const KafkaPartitionStats &p) { return p.fetchq_size; });
+
+        auto client_gauge = [&](const char *name, const char *help, auto value) {
+            fmt::format_to(it, "# HELP md_{0} {1}\n# TYPE md_{0} gauge\n", name, help);
+            for (const auto &[client, stats] : kafka_stats) {
+                if (stats) fmt::format_to(it, "md_{}{{client=\"{}\"}} {}\n", name, client, value(*stats));
+            }
+        };
+        client_gauge("kafka_queue_messages", "Messages in librdkafka producer queues",
+                     [](const KafkaStatsSnapshot &k) { return k.msg_cnt; });
+        client_gauge("kafka_queue_bytes", "Bytes in librdkafka producer queues",
+                     [](const KafkaStatsSnapshot &k) { return k.msg_size; });
+        client_gauge("kafka_batch_bytes_avg", "Average produced MessageSet size in bytes",
+                     [](const KafkaStatsSnapshot &k) { return k.batch_size_avg; });
+        client_gauge("kafka_batch_messages_avg", "Average messages per produced MessageSet",
+                     [](const KafkaStatsSnapshot &k) { return k.batch_cnt_avg; });
+
+        // Latencies as summaries, in seconds; label is the rendered label pair, e.g. stage="decode"
+        auto summary = [&](const char *name, const std::string &label, const LatencyDistribution &latency) {
+            for (double q : {0.5, 0.9, 0.99, 0.999}) {
+                fmt::format_to(it, "md_{}{{{},quantile=\"{}\"}} {:.9f}\n", name, label, q, latency.percentile(q) / 1e9);
+            }
+            fmt::format_to(it, "md_{}_sum{{{}}} {:.9f}\n", name, label, latency.sum() / 1e9);
+            fmt::format_to(it, "md_{}_count{{{}}} {}\n", name, label, latency.count());
+        };
+        out += "# HELP md_stage_latency_seconds Per-stage pipeline latency\n"
+               "# TYPE md_stage_latency_seconds summary\n";
+        for (size_t i = 0; i < kLatencyStageCount; ++i) {
+            const auto stage = static_cast<LatencyStage>(i);
+            summary("stage_latency_seconds", fmt::format("stage=\"{}\"", latency_stage_name(stage)), latency_.collect(stage));
+        }
+        LatencyDistribution delivery_latency;
+        delivery_latency.add(producer.delivery_latency());
+        summary("stage_latency_seconds", "stage=\"delivery\"", delivery_latency);
+
+        // End-to-end latency from the input Kafka timestamp, per input partition
+        auto partition_summaries = [&](const char *name, const char *help, const PartitionLatencyRecorder &recorder) {
+            fmt::format_to(it, "# HELP md_{0} {1}\n# TYPE md_{0} summary\n", name, help);
+            for (int32_t partition = 0; partition < recorder.partition_limit(); ++partition) {
+                LatencyDistribution latency = recorder.collect(partition);
+                if (latency.count() == 0) continue;
+                summary(name, fmt::format("partition=\"{}\"", partition), latency);
+            }
+        };
+        partition_summaries("ingest_to_consume_seconds", "Input Kafka timestamp to consumed by the processor",
+                            consume_latency_);
+        partition_summaries("ingest_to_enqueue_seconds", "Input Kafka timestamp to output enqueued in the producer",
+                            enqueue_latency_);
+        partition_summaries("ingest_to_delivery_seconds", "Input Kafka timestamp to output acknowledged by the broker",
+                            producer.ingest_delivery_latency());
     }
 
     // ProcessorShutdownHandler Implementation
@@ -407,11 +1279,13 @@ namespace market_depth {
         instance_ = this;
         signal(SIGINT, signal_handler);
         signal(SIGTERM, signal_handler);
+        signal(SIGUSR1, dump_signal_handler);
     }
 
     ProcessorShutdownHandler::~ProcessorShutdownHandler() {
         signal(SIGINT, SIG_DFL);
         signal(SIGTERM, SIG_DFL);
+        signal(SIGUSR1, SIG_DFL);
         instance_ = nullptr;
     }
 
@@ -422,4 +1296,11 @@ namespace market_depth {
         }
     }
 
+    void ProcessorShutdownHandler::dump_signal_handler(int /*signal*/) {
+        // Only flag it: the processing loop logs the dump
+        if (instance_) {
+            instance_->processor_.request_flight_recorder_dump();
+        }
+    }
+
 } // namespace market_depth
\ No newline at end of file
@@ -5,8 +5,9 @@
 
 #include "MessageFactory.hpp"
 #include "spdlog/spdlog.h"
+#include <algorithm>
+#include <charconv>
 #include <chrono>
-#include <cmath>
 
 namespace market_depth {
 
@@ -21,61 +22,84 @@ namespace market_depth {
     }
 
     // MessageFactory implementation
-    MessageFactory::MessageFactory(const JsonConfig &config) : config_(config) {
+    MessageFactory::MessageFactory(const JsonConfig &config)
+        : config_(config), default_exchanges_(exchange_bit(exchanges_.register_exchange(config_.exchange_name))) {
         SPDLOG_DEBUG("MessageFactory created with price_decimals={}, quantity_decimals={}",
                      config_.price_decimals, config_.quantity_decimals);
     }
 
-    MessageFactory::MessageFactory() : config_() {
+    MessageFactory::MessageFactory()
+        : config_(), default_exchanges_(exchange_bit(exchanges_.register_exchange(config_.exchange_name))) {
+    }
+
+    void MessageFactory::update_config(const JsonConfig &config) {
+        config_ = config;
+        default_exchanges_ = exchange_bit(exchanges_.register_exchange(config_.exchange_name));
     }
 
     std::string MessageFactory::create_snapshot_json(const InternalOrderBookSnapshot &snapshot,
                                                      uint32_t depth) const {
-        nlohmann::json j;
+        std::string out;
+        write_snapshot_json(snapshot, depth, out);
+        return out;
+    }
 
-        // Add common fields
-        add_common_fields(j, snapshot.symbol, snapshot.sequence, snapshot.timestamp);
+    void MessageFactory::write_snapshot_json(const InternalOrderBookSnapshot &snapshot, uint32_t depth,
+                                             std::string &out) const {
+        // Streamed straight into out, no document tree. Keys are written in sorted
+        // order, the layout downstream consumers already receive
+        JsonWriter w(out, config_.compact_format ? -1 : 2);
+        auto top_bids = snapshot.get_top_bids(depth);
+        auto top_asks = snapshot.get_top_asks(depth);
 
-        // j["message_type"] = "snapshot";
-        j["depth"] = depth;
+        w.begin_object();
 
-        // Add bid side (top depth levels)
-        nlohmann::json bids = nlohmann::json::array();
-        auto top_bids = snapshot.get_top_bids(depth);
-        for (const auto &level: top_bids) {
-            bids.push_back(price_level_to_json(level, OrderSide::Buy, snapshot.symbol));
+        // Ask side (top depth levels)
+        w.key("asks");
+        w.begin_array();
+        for (uint32_t i = 0; i < top_asks.size(); ++i) {
+            write_price_level(w, top_asks[i], OrderSide::Sell, snapshot.symbol);
         }
-        j["bids"] = bids;
+        w.end_array();
 
-        // Add ask side (top depth levels)
-        nlohmann::json asks = nlohmann::json::array();
-        auto top_asks = snapshot.get_top_asks(depth);
-        for (const auto &level: top_asks) {
-            asks.push_back(price_level_to_json(level, OrderSide::Sell, snapshot.symbol));
+        // Bid side (top depth levels)
+        w.key("bids");
+        w.begin_array();
+        for (uint32_t i = 0; i < top_bids.size(); ++i) {
+            write_price_level(w, top_bids[i], OrderSide::Buy, snapshot.symbol);
         }
-        j["asks"] = asks;
+        w.end_array();
+
+        w.field("depth", depth);
 
-        // Add trade info if available
+        // Trade info if available
         if (snapshot.last_trade_price > 0) {
-            j["last_trade"] = {
-                {"price", format_price(snapshot.last_trade_price)},
-                {"quantity", format_quantity(snapshot.last_trade_quantity)}
-            };
+            w.key("last_trade");
+            w.begin_object();
+            write_price(w, "price", snapshot.last_trade_price);
+            write_quantity(w, "quantity", snapshot.last_trade_quantity);
+            w.end_object();
         }
 
-        // Add market stats
-        j["market_stats"] = {
-            {"total_bid_levels", snapshot.bid_levels.size()},
-            {"total_ask_levels", snapshot.ask_levels.size()},
-            {"has_sufficient_depth", snapshot.has_sufficient_depth(depth)}
-        };
-
+        // Market stats (levels within this depth view; the snapshot may hold more)
+        w.key("market_stats");
+        w.begin_object();
+        w.field("has_sufficient_depth", snapshot.has_sufficient_depth(depth));
         if (!top_bids.empty() && !top_asks.empty()) {
-            j["market_stats"]["spread"] = format_price(top_asks[0].price - top_bids[0].price);
-            j["market_stats"]["mid_price"] = format_price((top_asks[0].price + top_bids[0].price) / 2);
+            write_price(w, "mid_price", (top_asks.price(0) + top_bids.price(0)) / 2);
+            write_price(w, "spread", top_asks.price(0) - top_bids.price(0));
+        }
+        w.field("total_ask_levels", top_asks.size());
+        w.field("total_bid_levels", top_bids.size());
+        w.end_object();
+
+        // Common fields
+        if (config_.include_sequence) {
+            w.field("sequence", snapshot.sequence);
         }
+        w.field("symbol", snapshot.symbol);
 
-        return config_.compact_format ? j.dump() : j.dump(2);
+        w.end_object();
     }
 
     // CDC functionality removed - not needed in simplified version
@@ -103,67 +127,63 @@ namespace market_depth {
         return result;
     }
 
-    std::string MessageFactory::format_price(uint64_t price_scaled) const {
-        // Assuming price is scaled by 10000 (4 decimal places)
-        double price = static_cast<double>(price_scaled) / std::pow(10, config_.price_decimals);
+    size_t MessageFactory::format_fixed_point(uint64_t scaled, uint32_t decimals, char *out) {
+        static constexpr uint64_t kPow10[kMaxFixedPointDecimals + 1] = {
+            1ull, 10ull, 100ull, 1000ull, 10000ull, 100000ull, 1000000ull, 10000000ull,
+            100000000ull, 1000000000ull, 10000000000ull, 100000000000ull, 1000000000000ull,
+            10000000000000ull, 100000000000000ull, 1000000000000000ull, 10000000000000000ull,
+            100000000000000000ull, 1000000000000000000ull, 10000000000000000000ull
+        };
 
-        std::ostringstream ss;
-        ss << std::fixed << std::setprecision(config_.price_decimals) << price;
-        return ss.str();
+        decimals = std::min(decimals, kMaxFixedPointDecimals);
+        const uint64_t integer_part = scaled / kPow10[decimals];
+        uint64_t fraction = scaled % kPow10[decimals];
+
+        char *p = std::to_chars(out, out + kMaxFixedPointChars, integer_part).ptr;
+        if (decimals > 0) {
+            *p++ = '.';
+            // Fraction digits right to left, zero-padded to exactly `decimals` places
+            for (uint32_t i = decimals; i > 0; --i) {
+                p[i - 1] = static_cast<char>('0' + fraction % 10);
+                fraction /= 10;
+            }
+            p += decimals;
+        }
+        return static_cast<size_t>(p - out);
     }
 
-    std::string MessageFactory::format_quantity(uint64_t quantity_scaled) const {
-        // Assuming quantity is scaled by 100 (2 decimal places)
-        double quantity = static_cast<double>(quantity_scaled) / std::pow(10, config_.quantity_decimals);
-
-        std::ostringstream ss;
-        ss << std::fixed << std::setprecision(config_.quantity_decimals) << quantity;
-        return ss.str();
+    void MessageFactory::write_price(JsonWriter &w, std::string_view name, uint64_t price_scaled) const {
+        char buffer[kMaxFixedPointChars];
+        w.key(name);
+        w.value_unescaped(buffer, format_fixed_point(price_scaled, config_.price_decimals, buffer));
     }
 
-    nlohmann::json MessageFactory::price_level_to_json(const PriceLevel &level, OrderSide side,
-                                                       const std::string &symbol) const {
-        nlohmann::json j;
-
-        j["symbol"] = symbol;
-        j["side"] = side_to_string(side);
-        j["price"] = format_price(level.price);
-        j["quantity"] = format_quantity(level.quantity);
-        j["number_of_orders"] = level.num_orders;
-
-        // Add exchanges array
-        if (!level.exchanges.empty()) {
-            j["exchanges"] = level.exchanges;
-        } else {
-            // Default to configured exchange
-            j["exchanges"] = nlohmann::json::array({config_.exchange_name});
-        }
-
-        return j;
+    void MessageFactory::write_quantity(JsonWriter &w, std::string_view name, uint64_t quantity_scaled) const {
+        char buffer[kMaxFixedPointChars];
+        w.key(name);
+        w.value_unescaped(buffer, format_fixed_point(quantity_scaled, config_.quantity_decimals, buffer));
     }
 
-    void MessageFactory::add_common_fields(nlohmann::json &j, const std::string &symbol,
-                                           uint64_t sequence, uint64_t timestamp) const {
-        j["symbol"] = symbol;
-
-        if (config_.include_sequence) {
-            j["sequence"] = sequence;
-        }
+    void MessageFactory::write_price_level(JsonWriter &w, const PriceLevel &level, OrderSide side,
+                                           const std::string &symbol) const {
+        w.begin_object();
 
-        // if (config_.include_timestamp) {
-            // j["timestamp"] = timestamp;
+        // Venue names were escaped once at registration; render them from the level's mask
+        w.key("exchanges");
+        w.begin_array();
+        exchanges_.for_each(level.exchanges, [&](ExchangeId id) {
+            const std::string &name = exchanges_.escaped_name(id);
+            w.value_unescaped(name.data(), name.size());
+        });
+        w.end_array();
 
-            // Also add human-readable timestamp
-            // auto timestamp_ms = timestamp / 1000;
-            // auto time_point = std::chrono::system_clock::from_time_t(timestamp_ms / 1000);
-            // auto ms_part = timestamp_ms % 1000;
+        w.field("number_of_orders", level.num_orders);
+        write_price(w, "price", level.price);
+        write_quantity(w, "quantity", level.quantity);
+        w.field("side", side_to_string(side));
+        w.field("symbol", symbol);
 
-            // std::time_t tt = std::chrono::system_clock::to_time_t(time_point);
-            // std::ostringstream ss;
-            // ss << std::put_time(std::gmtime(&tt), "%Y-%m-%dT%H:%M:%S");
-            // ss << "." << std::setfill('0') << std::setw(3) << ms_part << "Z";
-            // j["timestamp_iso"] = ss.str();
-        // }
+        w.end_object();
     }
 
     std::string MessageFactory::side_to_string(OrderSide side) {
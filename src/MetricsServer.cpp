@@ -0,0 +1,160 @@
+/**
+ * @file    MetricsServer.cpp
+ * @brief   Prometheus metrics endpoint implementation
+ */
+
+#include "MetricsServer.hpp"
+#include "LogThrottle.hpp"
+#include "spdlog/spdlog.h"
+#include <arpa/inet.h>
+#include <cerrno>
+#include <cstring>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+namespace market_depth {
+
+namespace {
+
+constexpr int kAcceptPollMs = 200;       // How often the server thread checks for stop()
+constexpr int kSocketTimeoutS = 2;       // Per-connection read/write timeout
+constexpr size_t kMaxRequestBytes = 8192;
+
+bool send_all(int fd, const char *data, size_t size) {
+    while (size > 0) {
+        ssize_t sent = ::send(fd, data, size, MSG_NOSIGNAL);
+        if (sent < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        data += sent;
+        size -= static_cast<size_t>(sent);
+    }
+    return true;
+}
+
+} // namespace
+
+MetricsServer::MetricsServer(uint16_t port, Renderer renderer)
+    : port_(port), renderer_(std::move(renderer)), listen_fd_(-1), running_(false) {
+}
+
+MetricsServer::~MetricsServer() {
+    stop();
+}
+
+bool MetricsServer::start() {
+    if (running_) return true;
+
+    listen_fd_ = ::socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (listen_fd_ < 0) {
+        SPDLOG_ERROR("Metrics server: socket() failed: {}", std::strerror(errno));
+        return false;
+    }
+
+    int reuse = 1;
+    ::setsockopt(listen_fd_, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    addr.sin_port = htons(port_);
+    if (::bind(listen_fd_, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) < 0 ||
+        ::listen(listen_fd_, 16) < 0) {
+        SPDLOG_ERROR("Metrics server: cannot listen on port {}: {}", port_, std::strerror(errno));
+        ::close(listen_fd_);
+        listen_fd_ = -1;
+        return false;
+    }
+
+    running_ = true;
+    thread_ = std::thread(&MetricsServer::serve_loop, this);
+    SPDLOG_INFO("Metrics server listening on port {} (GET /metrics)", port_);
+    return true;
+}
+
+void MetricsServer::stop() {
+    if (!running_.exchange(false)) return;
+
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+    ::close(listen_fd_);
+    listen_fd_ = -1;
+    SPDLOG_INFO("Metrics server stopped");
+}
+
+void MetricsServer::serve_loop() {
+    pollfd pfd{listen_fd_, POLLIN, 0};
+
+    while (running_) {
+        int ready = ::poll(&pfd, 1, kAcceptPollMs);
+        if (ready <= 0) continue;
+
+        int fd = ::accept4(listen_fd_, nullptr, nullptr, SOCK_CLOEXEC);
+        if (fd < 0) {
+            if (errno != EINTR && errno != EAGAIN) {
+                MD_WARN_RATE_LIMITED(1, "Metrics server: accept() failed: {}", std::strerror(errno));
+            }
+            continue;
+        }
+
+        timeval timeout{kSocketTimeoutS, 0};
+        ::setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+        ::setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+
+        handle_connection(fd);
+        ::close(fd);
+    }
+}
+
+void MetricsServer::handle_connection(int fd) {
+    // Only the request line matters; read until the end of the headers
+    char request[kMaxRequestBytes];
+    size_t received = 0;
+    while (received < sizeof(request) - 1) {
+        ssize_t n = ::recv(fd, request + received, sizeof(request) - 1 - received, 0);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) break;
+        received += static_cast<size_t>(n);
+        request[received] = '\0';
+        if (std::strstr(request, "\r\n\r\n") || std::strstr(request, "\n\n")) break;
+    }
+    if (received == 0) return;
+    request[received] = '\0';
+
+    const char *status = "200 OK";
+    const char *content_type = "text/plain; version=0.0.4; charset=utf-8";
+    body_.clear();
+
+    if (std::strncmp(request, "GET ", 4) != 0) {
+        status = "405 Method Not Allowed";
+        content_type = "text/plain";
+        body_ = "Only GET is supported\n";
+    } else if (std::strncmp(request + 4, "/metrics", 8) == 0 &&
+               (request[12] == ' ' || request[12] == '?')) {
+        renderer_(body_);
+    } else {
+        status = "404 Not Found";
+        content_type = "text/plain";
+        body_ = "Try /metrics\n";
+    }
+
+    response_.clear();
+    response_ += "HTTP/1.1 ";
+    response_ += status;
+    response_ += "\r\nContent-Type: ";
+    response_ += content_type;
+    response_ += "\r\nContent-Length: ";
+    response_ += std::to_string(body_.size());
+    response_ += "\r\nConnection: close\r\n\r\n";
+
+    if (!send_all(fd, response_.data(), response_.size()) || !send_all(fd, body_.data(), body_.size())) {
+        MD_DEBUG_SAMPLED(100, "Metrics server: client went away mid-response: {}", std::strerror(errno));
+    }
+}
+
+} // namespace market_depth
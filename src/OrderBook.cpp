@@ -1,204 +1,378 @@
 /**
  * @file    OrderBook.cpp
- * @brief   Order book state management implementation
+ * @brief   Stateful order book implementation (snapshot seeding + delta application)
  */
 
 #include "OrderBook.hpp"
+#include "LogThrottle.hpp"
 #include "spdlog/spdlog.h"
 #include <algorithm>
 #include <shared_mutex>
 
 namespace market_depth {
 
-OrderBook::OrderBook(const std::string& symbol,
-                    const DepthConfig& config,
-                    CDCCallback cdc_callback)
-    : symbol_(symbol)
-    , config_(config)
-    , cdc_callback_(cdc_callback)
-    , message_count_(0)
-    , initialized_(false) {
+// OrderIdMap Implementation
 
-    current_snapshot_.symbol = symbol;
-    previous_snapshot_.symbol = symbol;
+OrderIdMap::OrderIdMap(size_t initial_capacity)
+    : mask_(0)
+    , shift_(64)
+    , size_(0) {
 
-    SPDLOG_DEBUG("OrderBook created for symbol: {}", symbol_);
-}
-
-bool OrderBook::process_snapshot(const fb::OrderBookSnapshot* snapshot) {
-    if (!snapshot) {
-        SPDLOG_ERROR("Null snapshot received for symbol: {}", symbol_);
-        return false;
+    size_t capacity = 16;
+    while (capacity < initial_capacity) {
+        capacity <<= 1;
     }
-
-    // Validate symbol matches
-    if (snapshot->symbol() && snapshot->symbol()->str() != symbol_) {
-        SPDLOG_ERROR("Symbol mismatch: expected {}, got {}", symbol_,
-                    snapshot->symbol()->str());
-        return false;
-    }
-
-    // Store previous state for CDC comparison
-    if (initialized_ && config_.enable_cdc) {
-        previous_snapshot_ = current_snapshot_;
+    entries_.assign(capacity, Entry{0, kInvalidSlot});
+    mask_ = capacity - 1;
+    while ((size_t{1} << (64 - shift_)) < capacity) {
+        --shift_;
     }
+}
 
-    // Update sequence and timestamp
-    current_snapshot_.sequence = snapshot->seq();
-    current_snapshot_.timestamp = get_timestamp();
+uint32_t OrderIdMap::find(uint64_t order_id) const {
+    if (order_id == 0) return kInvalidSlot;
 
-    // Update trade info
-    current_snapshot_.last_trade_price = snapshot->recent_trade_price();
-    current_snapshot_.last_trade_quantity = snapshot->recent_trade_qty();
+    for (size_t i = home_index(order_id); ; i = (i + 1) & mask_) {
+        const Entry& entry = entries_[i];
+        if (entry.order_id == order_id) return entry.slot;
+        if (entry.order_id == 0) return kInvalidSlot;
+    }
+}
 
-    // Clear current levels
-    current_snapshot_.bid_levels.clear();
-    current_snapshot_.ask_levels.clear();
+bool OrderIdMap::insert(uint64_t order_id, uint32_t slot) {
+    if (order_id == 0) return false;
 
-    // Process buy side levels
-    if (snapshot->buy_side()) {
-        process_price_levels(snapshot->buy_side(), OrderSide::Buy, snapshot->seq());
+    // Keep the load factor at or below 1/2 so probe sequences stay short
+    if ((size_ + 1) * 2 > entries_.size()) {
+        grow();
     }
 
-    // Process sell side levels
-    if (snapshot->sell_side()) {
-        process_price_levels(snapshot->sell_side(), OrderSide::Sell, snapshot->seq());
+    for (size_t i = home_index(order_id); ; i = (i + 1) & mask_) {
+        Entry& entry = entries_[i];
+        if (entry.order_id == order_id) return false;
+        if (entry.order_id == 0) {
+            entry = Entry{order_id, slot};
+            ++size_;
+            return true;
+        }
     }
+}
 
-    ++message_count_;
+bool OrderIdMap::erase(uint64_t order_id) {
+    if (order_id == 0) return false;
 
-    // Generate CDC events if enabled and not first snapshot
-    if (initialized_ && config_.enable_cdc && cdc_callback_) {
-        generate_cdc_events(previous_snapshot_.bid_levels, current_snapshot_.bid_levels,
-                          OrderSide::Buy, snapshot->seq());
-        generate_cdc_events(previous_snapshot_.ask_levels, current_snapshot_.ask_levels,
-                          OrderSide::Sell, snapshot->seq());
+    size_t hole = home_index(order_id);
+    while (entries_[hole].order_id != order_id) {
+        if (entries_[hole].order_id == 0) return false;
+        hole = (hole + 1) & mask_;
     }
 
-    if (!initialized_) {
-        initialized_ = true;
-        SPDLOG_DEBUG("OrderBook initialized for symbol: {} with {} bids, {} asks",
-                    symbol_, current_snapshot_.bid_levels.size(),
-                    current_snapshot_.ask_levels.size());
+    // Backward-shift: pull later entries of the cluster into the hole when
+    // their home position does not lie cyclically in (hole, i]
+    for (size_t i = (hole + 1) & mask_; entries_[i].order_id != 0; i = (i + 1) & mask_) {
+        size_t home = home_index(entries_[i].order_id);
+        bool stays = hole <= i ? (hole < home && home <= i) : (hole < home || home <= i);
+        if (!stays) {
+            entries_[hole] = entries_[i];
+            hole = i;
+        }
     }
 
+    entries_[hole] = Entry{0, kInvalidSlot};
+    --size_;
     return true;
 }
 
-void OrderBook::process_price_levels(
-    const ::flatbuffers::Vector<::flatbuffers::Offset<fb::OrderMsgLevel>>* levels,
-    OrderSide side,
-    uint64_t sequence) {
+void OrderIdMap::clear() {
+    std::fill(entries_.begin(), entries_.end(), Entry{0, kInvalidSlot});
+    size_ = 0;
+}
 
-    if (!levels) return;
+void OrderIdMap::grow() {
+    std::vector<Entry> old_entries(entries_.size() * 2, Entry{0, kInvalidSlot});
+    old_entries.swap(entries_);
+    mask_ = entries_.size() - 1;
+    --shift_;
+    size_ = 0;
 
-    for (uint32_t i = 0; i < levels->size() && i < config_.max_price_levels; ++i) {
-        const auto* level = levels->Get(i);
-        if (!level) continue;
+    for (const Entry& entry : old_entries) {
+        if (entry.order_id != 0) {
+            insert(entry.order_id, entry.slot);
+        }
+    }
+}
 
-        PriceLevel price_level;
-        price_level.price = level->price();
-        price_level.quantity = 0;
-        price_level.num_orders = 0;
+// OrderBook Implementation
 
-        // Aggregate orders at this price level
-        if (level->orders()) {
+OrderBook::OrderBook(const std::string& symbol, ExchangeMask exchanges)
+    : symbol_(symbol)
+    , exchanges_(exchanges)
+    , free_slot_(kInvalidSlot)
+    , last_sequence_(0)
+    , last_trade_price_(0)
+    , last_trade_quantity_(0)
+    , message_count_(0)
+    , initialized_(false) {
+
+    SPDLOG_DEBUG("OrderBook created for symbol: {}", symbol_);
+}
+
+void OrderBook::clear() {
+    // Pool and index keep their capacity across re-seeds
+    bid_levels_.clear();
+    ask_levels_.clear();
+    orders_.clear();
+    free_slot_ = kInvalidSlot;
+    order_index_.clear();
+}
+
+void OrderBook::apply_snapshot(const fb::OrderBookSnapshot* snapshot) {
+    if (!snapshot) return;
+
+    clear();
+
+    // Orders arrive in queue order within each level, so appending preserves time priority
+    auto seed_side = [this](const ::flatbuffers::Vector<::flatbuffers::Offset<fb::OrderMsgLevel>>* levels,
+                            OrderSide side) {
+        if (!levels) return;
+        for (uint32_t i = 0; i < levels->size(); ++i) {
+            const auto* level = levels->Get(i);
+            if (!level || !level->orders()) continue;
             for (uint32_t j = 0; j < level->orders()->size(); ++j) {
                 const auto* order = level->orders()->Get(j);
                 if (order) {
-                    price_level.quantity += order->qty();
-                    price_level.num_orders++;
+                    add_order(order->id(), side, level->price(), order->qty());
                 }
             }
         }
+    };
 
-        // Add to appropriate side
-        if (side == OrderSide::Buy) {
-            current_snapshot_.bid_levels[price_level.price] = price_level;
-        } else {
-            current_snapshot_.ask_levels[price_level.price] = price_level;
-        }
+    seed_side(snapshot->buy_side(), OrderSide::Buy);
+    seed_side(snapshot->sell_side(), OrderSide::Sell);
+
+    last_sequence_ = snapshot->seq();
+    last_trade_price_ = snapshot->recent_trade_price();
+    last_trade_quantity_ = snapshot->recent_trade_qty();
+    ++message_count_;
+
+    if (!initialized_) {
+        initialized_ = true;
+        SPDLOG_DEBUG("OrderBook seeded for symbol: {} with {} bids, {} asks, {} orders",
+                     symbol_, bid_levels_.size(), ask_levels_.size(), order_index_.size());
     }
 }
 
-void OrderBook::generate_cdc_events(
-    const std::map<uint64_t, PriceLevel, std::greater<uint64_t>>& old_levels,
-    const std::map<uint64_t, PriceLevel, std::greater<uint64_t>>& new_levels,
-    OrderSide side,
-    uint64_t sequence) {
+bool OrderBook::apply_delta(const fb::FBBookDeltaEvent* event) {
+    if (!event) return false;
+
+    bool applied = true;
+    switch (event->kind()) {
+        case fb::Kind_Add:
+            add_order(event->order_id(), to_side(event->side()), event->price(), event->qty());
+            break;
+
+        case fb::Kind_Modify: {
+            uint32_t slot = order_index_.find(event->order_id());
+            if (slot == kInvalidSlot) {
+                applied = false;
+                break;
+            }
+            const BookOrder& order = orders_[slot];
+            if (event->price() == order.price && event->qty() > 0 && event->qty() <= order.quantity) {
+                // Size reduction at the same price keeps queue position
+                reduce_order(slot, order.quantity - event->qty());
+            } else {
+                // Price change or size increase loses time priority
+                OrderSide side = order.side;
+                remove_order(event->order_id());
+                add_order(event->order_id(), side, event->price(), event->qty());
+            }
+            break;
+        }
 
-    // Find removed levels
-    for (const auto& [price, old_level] : old_levels) {
-        if (new_levels.find(price) == new_levels.end()) {
-            emit_cdc_event(CDCEventType::LevelRemoved, side, old_level, sequence);
+        case fb::Kind_Remove:
+            applied = remove_order(event->order_id());
+            break;
+
+        case fb::Kind_Trade: {
+            last_trade_price_ = event->price();
+            last_trade_quantity_ = event->qty();
+
+            // Executed quantity comes off the resting order, if known
+            uint32_t slot = order_index_.find(event->order_id());
+            if (slot != kInvalidSlot) {
+                if (event->qty() >= orders_[slot].quantity) {
+                    remove_order(event->order_id());
+                } else {
+                    reduce_order(slot, event->qty());
+                }
+            }
+            break;
         }
+
+        default:
+            applied = false;
+            break;
     }
 
-    // Find added and modified levels
-    for (const auto& [price, new_level] : new_levels) {
-        auto old_it = old_levels.find(price);
-        if (old_it == old_levels.end()) {
-            emit_cdc_event(CDCEventType::LevelAdded, side, new_level, sequence);
-        } else if (old_it->second != new_level) {
-            emit_cdc_event(CDCEventType::LevelModified, side, new_level, sequence);
-        }
+    if (event->seq() > last_sequence_) {
+        last_sequence_ = event->seq();
     }
+    return applied;
 }
 
-void OrderBook::generate_cdc_events(
-    const std::map<uint64_t, PriceLevel>& old_levels,
-    const std::map<uint64_t, PriceLevel>& new_levels,
-    OrderSide side,
-    uint64_t sequence) {
+size_t OrderBook::apply_delta_batch(const fb::DeltaBatch* batch, uint64_t min_seq) {
+    if (!batch || !batch->events()) return 0;
 
-    // Find removed levels
-    for (const auto& [price, old_level] : old_levels) {
-        if (new_levels.find(price) == new_levels.end()) {
-            emit_cdc_event(CDCEventType::LevelRemoved, side, old_level, sequence);
+    size_t applied = 0;
+    for (uint32_t i = 0; i < batch->events()->size(); ++i) {
+        const auto* event = batch->events()->Get(i);
+        if (event && event->seq() != 0 && event->seq() < min_seq) {
+            continue;  // Overlap with input the book already has
+        }
+        if (apply_delta(event)) {
+            ++applied;
+        } else {
+            MD_DEBUG_SAMPLED(1000, "OrderBook {}: delta {} for unknown order {} ignored",
+                             symbol_, event ? event->seq() : 0, event ? event->order_id() : 0);
         }
     }
 
-    // Find added and modified levels
-    for (const auto& [price, new_level] : new_levels) {
-        auto old_it = old_levels.find(price);
-        if (old_it == old_levels.end()) {
-            emit_cdc_event(CDCEventType::LevelAdded, side, new_level, sequence);
-        } else if (old_it->second != new_level) {
-            emit_cdc_event(CDCEventType::LevelModified, side, new_level, sequence);
-        }
+    if (batch->seq_end() > last_sequence_) {
+        last_sequence_ = batch->seq_end();
     }
+    ++message_count_;
+    return applied;
 }
 
-void OrderBook::emit_cdc_event(CDCEventType type, OrderSide side,
-                              const PriceLevel& level, uint64_t sequence) {
-    if (!cdc_callback_) return;
+void OrderBook::fill_snapshot(InternalOrderBookSnapshot& out, uint32_t max_levels) const {
+    out.symbol = symbol_;
+    out.sequence = last_sequence_;
+    out.last_trade_price = last_trade_price_;
+    out.last_trade_quantity = last_trade_quantity_;
+    out.bid_levels.clear();
+    out.ask_levels.clear();
+
+    // Level aggregates are maintained incrementally: no per-order work here
+    uint32_t count = 0;
+    for (auto it = bid_levels_.begin(); it != bid_levels_.end() && count < max_levels; ++it, ++count) {
+        const PriceLevel& level = it->second.aggregate;
+        if (!out.bid_levels.insert(level.price, level.quantity, level.num_orders, level.exchanges)) break;
+    }
+    count = 0;
+    for (auto it = ask_levels_.begin(); it != ask_levels_.end() && count < max_levels; ++it, ++count) {
+        const PriceLevel& level = it->second.aggregate;
+        if (!out.ask_levels.insert(level.price, level.quantity, level.num_orders, level.exchanges)) break;
+    }
+}
 
-    CDCEvent event;
-    event.symbol = symbol_;
-    event.side = side;
-    event.event_type = type;
-    event.level = level;
-    event.sequence = sequence;
-    event.timestamp = get_timestamp();
+void OrderBook::add_order(uint64_t order_id, OrderSide side, uint64_t price, uint64_t quantity) {
+    // A re-used order_id (delta Add or a duplicate within a snapshot) replaces the previous order
+    if (order_id != 0 && remove_order(order_id)) {
+        MD_DEBUG_SAMPLED(1000, "OrderBook {}: order_id {} re-used, previous order replaced", symbol_, order_id);
+    }
+    if (price == 0 || quantity == 0) return;
+
+    uint32_t slot = allocate_slot();
+
+    // order_id 0 means the feed does not identify the order: queued and aggregated, never indexed
+    if (order_id != 0) {
+        order_index_.insert(order_id, slot);
+    }
 
-    cdc_callback_(event);
+    BookLevel& level = side == OrderSide::Buy ? bid_levels_[price] : ask_levels_[price];
+    level.aggregate.price = price;
+    level.aggregate.quantity += quantity;
+    level.aggregate.num_orders++;
+    level.aggregate.exchanges |= exchanges_;
+
+    // Append to the tail of the level's FIFO queue
+    orders_[slot] = BookOrder{order_id, price, quantity, level.tail, kInvalidSlot, side};
+    if (level.tail != kInvalidSlot) {
+        orders_[level.tail].next = slot;
+    } else {
+        level.head = slot;
+    }
+    level.tail = slot;
 }
 
-uint64_t OrderBook::get_timestamp() {
-    return std::chrono::duration_cast<std::chrono::microseconds>(
-        std::chrono::high_resolution_clock::now().time_since_epoch()).count();
+bool OrderBook::remove_order(uint64_t order_id) {
+    uint32_t slot = order_index_.find(order_id);
+    if (slot == kInvalidSlot) return false;
+
+    order_index_.erase(order_id);
+    unlink_slot(slot);
+    release_slot(slot);
+    return true;
 }
 
-// OrderBookManager Implementation
+void OrderBook::reduce_order(uint32_t slot, uint64_t quantity) {
+    BookOrder& order = orders_[slot];
+    if (BookLevel* level = find_level(order.side, order.price)) {
+        level->aggregate.quantity -= std::min(quantity, level->aggregate.quantity);
+    }
+    order.quantity -= quantity;
+}
 
-OrderBookManager::OrderBookManager(const DepthConfig& config,
-                                 CDCCallback global_cdc_callback)
-    : config_(config)
-    , global_cdc_callback_(global_cdc_callback) {
+uint32_t OrderBook::allocate_slot() {
+    if (free_slot_ != kInvalidSlot) {
+        uint32_t slot = free_slot_;
+        free_slot_ = orders_[slot].next;
+        return slot;
+    }
+    orders_.emplace_back();
+    return static_cast<uint32_t>(orders_.size() - 1);
+}
 
-    SPDLOG_INFO("OrderBookManager created with max_levels={}", config_.max_price_levels);
+void OrderBook::release_slot(uint32_t slot) {
+    orders_[slot].next = free_slot_;
+    free_slot_ = slot;
 }
 
+void OrderBook::unlink_slot(uint32_t slot) {
+    const BookOrder& order = orders_[slot];
+    BookLevel* level = find_level(order.side, order.price);
+    if (!level) return;
+
+    if (order.prev != kInvalidSlot) {
+        orders_[order.prev].next = order.next;
+    } else {
+        level->head = order.next;
+    }
+    if (order.next != kInvalidSlot) {
+        orders_[order.next].prev = order.prev;
+    } else {
+        level->tail = order.prev;
+    }
+
+    level->aggregate.quantity -= std::min(order.quantity, level->aggregate.quantity);
+    if (level->aggregate.num_orders > 0) {
+        level->aggregate.num_orders--;
+    }
+    if (level->head == kInvalidSlot) {
+        erase_level(order.side, order.price);
+    }
+}
+
+BookLevel* OrderBook::find_level(OrderSide side, uint64_t price) {
+    if (side == OrderSide::Buy) {
+        auto it = bid_levels_.find(price);
+        return it != bid_levels_.end() ? &it->second : nullptr;
+    }
+    auto it = ask_levels_.find(price);
+    return it != ask_levels_.end() ? &it->second : nullptr;
+}
+
+void OrderBook::erase_level(OrderSide side, uint64_t price) {
+    if (side == OrderSide::Buy) {
+        bid_levels_.erase(price);
+    } else {
+        ask_levels_.erase(price);
+    }
+}
+
+// OrderBookManager Implementation
+
 OrderBook* OrderBookManager::get_or_create_orderbook(const std::string& symbol) {
     // First try with shared lock for read
     {
@@ -219,7 +393,7 @@ OrderBook* OrderBookManager::get_or_create_orderbook(const std::string& symbol)
     }
 
     // Create new order book
-    auto orderbook = std::make_unique<OrderBook>(symbol, config_, global_cdc_callback_);
+    auto orderbook = std::make_unique<OrderBook>(symbol, exchanges_);
     OrderBook* ptr = orderbook.get();
     orderbooks_[symbol] = std::move(orderbook);
 
@@ -227,35 +401,6 @@ OrderBook* OrderBookManager::get_or_create_orderbook(const std::string& symbol)
     return ptr;
 }
 
-bool OrderBookManager::process_snapshot(const fb::OrderBookSnapshot* snapshot) {
-    if (!snapshot || !snapshot->symbol()) {
-        SPDLOG_ERROR("Invalid snapshot: null or missing symbol");
-        return false;
-    }
-
-    std::string symbol = snapshot->symbol()->str();
-    OrderBook* orderbook = get_or_create_orderbook(symbol);
-
-    if (!orderbook) {
-        SPDLOG_ERROR("Failed to get/create orderbook for symbol: {}", symbol);
-        return false;
-    }
-
-    bool success = orderbook->process_snapshot(snapshot);
-
-    // Update statistics
-    {
-        std::lock_guard lock(stats_mutex_);
-        if (success) {
-            stats_.increment_processed(symbol, snapshot->seq());
-        } else {
-            stats_.increment_errors();
-        }
-    }
-
-    return success;
-}
-
 std::vector<std::string> OrderBookManager::get_tracked_symbols() const {
     std::shared_lock lock(orderbooks_mutex_);
     std::vector<std::string> symbols;
@@ -268,9 +413,9 @@ std::vector<std::string> OrderBookManager::get_tracked_symbols() const {
     return symbols;
 }
 
-ProcessingStats OrderBookManager::get_aggregate_stats() const {
-    std::lock_guard lock(stats_mutex_);
-    return stats_;
+size_t OrderBookManager::size() const {
+    std::shared_lock lock(orderbooks_mutex_);
+    return orderbooks_.size();
 }
 
-} // namespace market_depth
\ No newline at end of file
+} // namespace market_depth
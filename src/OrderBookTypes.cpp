@@ -4,19 +4,21 @@
  */
 
 #include "OrderBookTypes.hpp"
+#include <algorithm>
 
 namespace market_depth {
 
     // PriceLevel implementations
-    PriceLevel::PriceLevel() : price(0), quantity(0), num_orders(0) {}
+    PriceLevel::PriceLevel() : price(0), quantity(0), num_orders(0), exchanges(0) {}
 
-    PriceLevel::PriceLevel(uint64_t p, uint64_t qty, uint32_t orders)
-        : price(p), quantity(qty), num_orders(orders) {}
+    PriceLevel::PriceLevel(uint64_t p, uint64_t qty, uint32_t orders, ExchangeMask venues)
+        : price(p), quantity(qty), num_orders(orders), exchanges(venues) {}
 
     bool PriceLevel::operator==(const PriceLevel& other) const {
         return price == other.price &&
                quantity == other.quantity &&
-               num_orders == other.num_orders;
+               num_orders == other.num_orders &&
+               exchanges == other.exchanges;
     }
 
     bool PriceLevel::operator!=(const PriceLevel& other) const {
@@ -30,37 +32,114 @@ namespace market_depth {
         , sequence(0)
         , timestamp(0) {}
 
+    // PriceLadder implementations
+    PriceLadder::PriceLadder(OrderSide side, uint32_t capacity)
+        : side_(side)
+        , size_(0)
+        , prices_(capacity)
+        , quantities_(capacity)
+        , num_orders_(capacity)
+        , exchanges_(capacity) {}
+
+    bool PriceLadder::insert(uint64_t price, uint64_t quantity, uint32_t num_orders, ExchangeMask exchanges) {
+        // Fast path: input is normally already best-first, so the new level goes at the end
+        uint32_t pos = size_;
+        if (size_ > 0 && !ranks_before(prices_[size_ - 1], price)) {
+            auto first = prices_.begin();
+            auto it = side_ == OrderSide::Buy
+                ? std::lower_bound(first, first + size_, price, std::greater<uint64_t>())
+                : std::lower_bound(first, first + size_, price);
+            pos = static_cast<uint32_t>(it - first);
+
+            if (pos < size_ && prices_[pos] == price) {
+                quantities_[pos] = quantity;
+                num_orders_[pos] = num_orders;
+                exchanges_[pos] = exchanges;
+                return true;
+            }
+        }
+
+        if (pos >= capacity()) {
+            return false;
+        }
+
+        // Shift worse levels down one slot; the worst falls off when full
+        uint32_t last = full() ? size_ - 1 : size_;
+        for (uint32_t i = last; i > pos; --i) {
+            prices_[i] = prices_[i - 1];
+            quantities_[i] = quantities_[i - 1];
+            num_orders_[i] = num_orders_[i - 1];
+            exchanges_[i] = exchanges_[i - 1];
+        }
+
+        prices_[pos] = price;
+        quantities_[pos] = quantity;
+        num_orders_[pos] = num_orders;
+        exchanges_[pos] = exchanges;
+        if (!full()) {
+            ++size_;
+        }
+        return true;
+    }
+
+    void PriceLadder::set_capacity(uint32_t capacity) {
+        prices_.resize(capacity);
+        quantities_.resize(capacity);
+        num_orders_.resize(capacity);
+        exchanges_.resize(capacity);
+        size_ = std::min(size_, capacity);
+    }
+
     // InternalOrderBookSnapshot implementations
-    InternalOrderBookSnapshot::InternalOrderBookSnapshot()
+    InternalOrderBookSnapshot::InternalOrderBookSnapshot(uint32_t max_price_levels)
         : sequence(0)
         , timestamp(0)
+        , ingest_timestamp_us(0)
+        , source_partition(-1)
+        , bid_levels(OrderSide::Buy, max_price_levels)
+        , ask_levels(OrderSide::Sell, max_price_levels)
         , last_trade_price(0)
         , last_trade_quantity(0) {}
 
-    std::vector<PriceLevel> InternalOrderBookSnapshot::get_top_bids(uint32_t depth) const {
-        std::vector<PriceLevel> result;
-        result.reserve(depth);
+    void InternalOrderBookSnapshot::clear() {
+        symbol.clear();
+        sequence = 0;
+        timestamp = 0;
+        ingest_timestamp_us = 0;
+        source_partition = -1;
+        bid_levels.clear();
+        ask_levels.clear();
+        last_trade_price = 0;
+        last_trade_quantity = 0;
+    }
 
-        auto it = bid_levels.begin();
-        for (uint32_t i = 0; i < depth && it != bid_levels.end(); ++i, ++it) {
-            result.push_back(it->second);
-        }
-        return result;
+    bool InternalOrderBookSnapshot::has_sufficient_depth(uint32_t min_levels) const {
+        return bid_levels.size() >= min_levels && ask_levels.size() >= min_levels;
     }
 
-    std::vector<PriceLevel> InternalOrderBookSnapshot::get_top_asks(uint32_t depth) const {
-        std::vector<PriceLevel> result;
-        result.reserve(depth);
+    namespace {
+        // Multiply-xorshift step: cheap, and every input bit reaches every output bit
+        inline uint64_t fingerprint_mix(uint64_t hash, uint64_t value) {
+            hash = (hash ^ value) * 0xff51afd7ed558ccdull;
+            return hash ^ (hash >> 32);
+        }
 
-        auto it = ask_levels.begin();
-        for (uint32_t i = 0; i < depth && it != ask_levels.end(); ++i, ++it) {
-            result.push_back(it->second);
+        uint64_t fingerprint_view(uint64_t hash, const LadderView& view) {
+            hash = fingerprint_mix(hash, view.size());
+            for (uint32_t i = 0; i < view.size(); ++i) {
+                hash = fingerprint_mix(hash, view.price(i));
+                hash = fingerprint_mix(hash, view.quantity(i));
+                hash = fingerprint_mix(hash, view.num_orders(i));
+                hash = fingerprint_mix(hash, view.exchanges(i));
+            }
+            return hash;
         }
-        return result;
     }
 
-    bool InternalOrderBookSnapshot::has_sufficient_depth(uint32_t min_levels) const {
-        return bid_levels.size() >= min_levels && ask_levels.size() >= min_levels;
+    uint64_t InternalOrderBookSnapshot::depth_fingerprint(uint32_t depth) const {
+        uint64_t hash = fingerprint_mix(0x9E3779B97F4A7C15ull, depth);
+        hash = fingerprint_view(hash, get_top_bids(depth));
+        return fingerprint_view(hash, get_top_asks(depth));
     }
 
 } // namespace market_depth
\ No newline at end of file
@@ -0,0 +1,58 @@
+/**
+ * @file    SymbolTable.cpp
+ * @brief   Symbol interning implementation
+ */
+
+#include "SymbolTable.hpp"
+#include "spdlog/spdlog.h"
+#include <mutex>
+
+namespace market_depth {
+
+SymbolTable::SymbolTable(std::string topic_prefix, const MessageRouter& router)
+    : topic_prefix_(std::move(topic_prefix)), router_(router), size_(0) {
+}
+
+SymbolId SymbolTable::intern(std::string_view symbol) {
+    // Fast path: already interned
+    {
+        std::shared_lock lock(mutex_);
+        auto it = index_.find(symbol);
+        if (it != index_.end()) {
+            return it->second;
+        }
+    }
+
+    std::unique_lock lock(mutex_);
+
+    // Double-check pattern
+    auto it = index_.find(symbol);
+    if (it != index_.end()) {
+        return it->second;
+    }
+
+    const uint32_t id = size_.load(std::memory_order_relaxed);
+    if ((id >> kChunkBits) >= kMaxChunks) {
+        SPDLOG_ERROR("Symbol table full ({} symbols), cannot intern {}", id, symbol);
+        return kInvalidSymbolId;
+    }
+
+    auto& chunk = chunks_[id >> kChunkBits];
+    if (!chunk) {
+        chunk = std::make_unique<SymbolState[]>(kChunkSize);
+    }
+
+    SymbolState& state = chunk[id & (kChunkSize - 1)];
+    state.symbol.assign(symbol.data(), symbol.size());
+    state.topic_name = topic_prefix_ + state.symbol;
+    state.partition = router_.calculate_partition(state.symbol);
+
+    index_.emplace(std::string_view(state.symbol), id);
+    size_.store(id + 1, std::memory_order_release);
+
+    SPDLOG_DEBUG("Interned symbol {} as id {} (topic {}, partition {})",
+                 state.symbol, id, state.topic_name, state.partition);
+    return id;
+}
+
+} // namespace market_depth
@@ -17,6 +17,7 @@
 #include <algorithm>
 #include <thread>
 #include <atomic>
+#include <stdexcept>
 #include <yaml-cpp/yaml.h>
 
 /* SpdLog library. */
@@ -176,8 +177,14 @@ market_depth::ProcessorConfig load_processor_config(const std::string& config_pa
             config.input_topic = proc["input_topic"] ? proc["input_topic"].as<std::string>() : "ORDERBOOK";
             config.consumer_poll_timeout_ms = proc["poll_timeout_ms"] ? proc["poll_timeout_ms"].as<int>() : 100;
             config.num_partitions = proc["num_partitions"] ? proc["num_partitions"].as<int>() : 8;
-            config.flush_interval_ms = proc["flush_interval_ms"] ? proc["flush_interval_ms"].as<uint32_t>() : 1000;
+            config.enable_partition_workers = proc["partition_workers"] ? proc["partition_workers"].as<bool>() : false;
+            config.enable_delta_processing = proc["enable_delta_processing"] ? proc["enable_delta_processing"].as<bool>() : false;
+            config.enable_conflation = proc["enable_conflation"] ? proc["enable_conflation"].as<bool>() : true;
+            config.catchup_publish_interval_ms = proc["catchup_publish_interval_ms"] ? proc["catchup_publish_interval_ms"].as<uint32_t>() : 1000;
+            config.backpressure_high_watermark = proc["backpressure_high_watermark"] ? proc["backpressure_high_watermark"].as<double>() : 0.8;
+            config.backpressure_low_watermark = proc["backpressure_low_watermark"] ? proc["backpressure_low_watermark"].as<double>() : 0.5;
             config.stats_report_interval_s = proc["stats_interval_s"] ? proc["stats_interval_s"].as<uint32_t>() : 30;
+            config.top_symbols_capacity = proc["top_symbols_capacity"] ? proc["top_symbols_capacity"].as<uint32_t>() : 1024;
         }
 
         // Load depth configuration (simplified - no CDC)
@@ -186,6 +193,37 @@ market_depth::ProcessorConfig load_processor_config(const std::string& config_pa
             if (depth["levels"]) {
                 config.depth_levels = depth["levels"].as<std::vector<uint32_t>>();
             }
+            config.max_price_levels = depth["max_price_levels"] ? depth["max_price_levels"].as<uint32_t>() : market_depth::kDefaultMaxPriceLevels;
+            config.suppress_unchanged_depths = depth["suppress_unchanged"] ? depth["suppress_unchanged"].as<bool>() : true;
+            config.depth_heartbeat_ms = depth["heartbeat_ms"] ? depth["heartbeat_ms"].as<uint32_t>() : 5000;
+        }
+
+        // Load input verification configuration (trusted unless a topic opts in)
+        if (yaml_config["input_verification"]) {
+            const auto& verification = yaml_config["input_verification"];
+            auto parse_mode = [](const std::string& mode) {
+                if (mode == "verified") return market_depth::InputVerification::Verified;
+                if (mode == "trusted") return market_depth::InputVerification::Trusted;
+                throw std::runtime_error("Invalid input_verification mode: " + mode + " (expected trusted or verified)");
+            };
+            config.default_verification = verification["default_mode"] ? parse_mode(verification["default_mode"].as<std::string>())
+                                                                        : market_depth::InputVerification::Trusted;
+            config.verifier_max_depth = verification["max_depth"] ? verification["max_depth"].as<uint32_t>() : 64;
+            config.verifier_max_tables = verification["max_tables"] ? verification["max_tables"].as<uint32_t>() : 1000000;
+            if (verification["topics"]) {
+                for (const auto& entry : verification["topics"]) {
+                    config.topic_verification[entry.first.as<std::string>()] = parse_mode(entry.second.as<std::string>());
+                }
+            }
+        }
+
+        // Load monitoring configuration
+        if (yaml_config["monitoring"]) {
+            const auto& monitoring = yaml_config["monitoring"];
+            config.enable_metrics_endpoint = monitoring["enable_metrics"] ? monitoring["enable_metrics"].as<bool>() : false;
+            config.metrics_port = monitoring["metrics_port"] ? monitoring["metrics_port"].as<uint16_t>() : 8080;
+            config.slow_message_threshold_us = monitoring["slow_processing_threshold_us"] ? monitoring["slow_processing_threshold_us"].as<uint32_t>() : 0;
+            config.flight_recorder_size = monitoring["flight_recorder_size"] ? monitoring["flight_recorder_size"].as<uint32_t>() : 1024;
         }
 
         // Load JSON formatting configuration
@@ -0,0 +1,308 @@
+/**
+ * @file    OrderBookTest.cpp
+ * @brief   OrderIdMap probing/deletion and the L3 book's order pool and level aggregates
+ *
+ * Exits non-zero on the first failed check.
+ */
+
+#include "OrderBook.hpp"
+#include "TestCheck.hpp"
+#include <map>
+#include <random>
+#include <tuple>
+#include <unordered_map>
+
+using namespace market_depth;
+
+namespace {
+
+struct TestOrder {
+    uint64_t id;
+    uint32_t qty;
+};
+
+struct TestLevel {
+    uint64_t price;
+    std::vector<TestOrder> orders;
+};
+
+struct TestEvent {
+    fb::Kind kind;
+    uint64_t order_id;
+    uint64_t price;
+    uint32_t qty;
+    fb::Side side;
+};
+
+// Payloads live in the builder: each build_* call invalidates the previous result
+const fb::OrderBookSnapshot* build_snapshot(::flatbuffers::FlatBufferBuilder& fbb, uint64_t seq,
+                                            const std::vector<TestLevel>& bids,
+                                            const std::vector<TestLevel>& asks) {
+    fbb.Clear();
+    auto build_side = [&fbb](const std::vector<TestLevel>& levels, fb::Side side) {
+        std::vector<::flatbuffers::Offset<fb::OrderMsgLevel>> built;
+        for (const auto& level : levels) {
+            std::vector<::flatbuffers::Offset<fb::OrderMsgOrder>> orders;
+            for (const auto& order : level.orders) {
+                orders.push_back(fb::CreateOrderMsgOrder(fbb, order.id, order.qty, side));
+            }
+            built.push_back(fb::CreateOrderMsgLevelDirect(fbb, level.price, &orders));
+        }
+        return built;
+    };
+    auto buy_side = build_side(bids, fb::Side_Buy);
+    auto sell_side = build_side(asks, fb::Side_Sell);
+    fbb.Finish(fb::CreateOrderBookSnapshotDirect(fbb, "TEST", seq, &buy_side, &sell_side));
+    return ::flatbuffers::GetRoot<fb::OrderBookSnapshot>(fbb.GetBufferPointer());
+}
+
+const fb::DeltaBatch* build_batch(::flatbuffers::FlatBufferBuilder& fbb, uint64_t seq_start,
+                                  const std::vector<TestEvent>& events) {
+    fbb.Clear();
+    std::vector<::flatbuffers::Offset<fb::FBBookDeltaEvent>> built;
+    uint64_t seq = seq_start;
+    for (const auto& event : events) {
+        built.push_back(fb::CreateFBBookDeltaEvent(fbb, event.kind, event.order_id, event.price, event.qty,
+                                                   event.side, seq++));
+    }
+    fbb.Finish(fb::CreateDeltaBatchDirect(fbb, "TEST", seq_start, seq - 1, &built));
+    return ::flatbuffers::GetRoot<fb::DeltaBatch>(fbb.GetBufferPointer());
+}
+
+// (price, quantity, orders) per level, best first
+using Ladder = std::vector<std::tuple<uint64_t, uint64_t, uint32_t>>;
+
+Ladder ladder(const PriceLadder& levels) {
+    Ladder out;
+    for (uint32_t i = 0; i < levels.size(); ++i) {
+        out.emplace_back(levels.price(i), levels.quantity(i), levels.num_orders(i));
+    }
+    return out;
+}
+
+void render(const OrderBook& book, InternalOrderBookSnapshot& out) {
+    book.fill_snapshot(out, out.bid_levels.capacity());
+}
+
+} // namespace
+
+static void order_id_map_basics() {
+    OrderIdMap map(16);
+    CHECK(map.find(42) == kInvalidSlot);
+    CHECK(map.insert(42, 7));
+    CHECK(!map.insert(42, 8));  // Duplicate leaves the map unchanged
+    CHECK(map.find(42) == 7);
+    CHECK(!map.insert(0, 1));   // 0 marks empty entries and is never indexed
+    CHECK(map.find(0) == kInvalidSlot);
+    CHECK(map.size() == 1);
+
+    CHECK(!map.erase(43));
+    CHECK(map.erase(42));
+    CHECK(!map.erase(42));
+    CHECK(map.find(42) == kInvalidSlot);
+    CHECK(map.size() == 0);
+}
+
+// Random inserts and erases against a reference map: exercises growth from a
+// tiny table, collision clusters, wrap-around and backward-shift deletion
+static void order_id_map_matches_reference() {
+    OrderIdMap map(16);
+    std::unordered_map<uint64_t, uint32_t> reference;
+    std::mt19937_64 rng(12345);
+
+    for (uint32_t i = 0; i < 200000; ++i) {
+        // Small id space keeps the table dense and clusters long
+        const uint64_t id = 1 + rng() % 5000;
+        if (rng() % 3 != 0) {
+            const bool inserted = map.insert(id, i);
+            CHECK(inserted == reference.emplace(id, i).second);
+        } else {
+            CHECK(map.erase(id) == (reference.erase(id) == 1));
+        }
+    }
+
+    CHECK(map.size() == reference.size());
+    for (uint64_t id = 1; id <= 5000; ++id) {
+        auto it = reference.find(id);
+        CHECK(map.find(id) == (it != reference.end() ? it->second : kInvalidSlot));
+    }
+
+    map.clear();
+    CHECK(map.size() == 0);
+    CHECK(map.find(reference.begin()->first) == kInvalidSlot);
+}
+
+static void order_id_map_grows() {
+    OrderIdMap map(16);
+    for (uint64_t id = 1; id <= 100000; ++id) {
+        CHECK(map.insert(id * 1024, static_cast<uint32_t>(id)));  // Sequential ids with a common stride
+    }
+    CHECK(map.size() == 100000);
+    for (uint64_t id = 1; id <= 100000; ++id) {
+        CHECK(map.find(id * 1024) == id);
+    }
+}
+
+static void snapshot_seeds_level_aggregates() {
+    ::flatbuffers::FlatBufferBuilder fbb;
+    InternalOrderBookSnapshot out(10);
+    OrderBook book("TEST");
+
+    book.apply_snapshot(build_snapshot(fbb, 5,
+                                       {{100, {{1, 10}, {2, 20}}}, {99, {{3, 5}}}},
+                                       {{101, {{4, 7}}}, {102, {{0, 3}, {0, 4}}}}));
+    CHECK(book.is_initialized());
+    CHECK(book.get_last_sequence() == 5);
+    CHECK(book.get_order_count() == 4);  // Unidentified (id 0) orders are aggregated but not indexed
+
+    render(book, out);
+    CHECK(ladder(out.bid_levels) == (Ladder{{100, 30, 2}, {99, 5, 1}}));
+    CHECK(ladder(out.ask_levels) == (Ladder{{101, 7, 1}, {102, 7, 2}}));
+
+    // Re-seeding replaces everything
+    book.apply_snapshot(build_snapshot(fbb, 9, {{98, {{5, 1}}}}, {}));
+    render(book, out);
+    CHECK(book.get_order_count() == 1);
+    CHECK(ladder(out.bid_levels) == (Ladder{{98, 1, 1}}));
+    CHECK(out.ask_levels.empty());
+}
+
+// A duplicate order_id in a snapshot replaces the earlier order instead of
+// leaving unreachable liquidity on its level
+static void duplicate_snapshot_order_is_replaced() {
+    ::flatbuffers::FlatBufferBuilder fbb;
+    InternalOrderBookSnapshot out(10);
+    OrderBook book("TEST");
+
+    book.apply_snapshot(build_snapshot(fbb, 1, {{100, {{1, 10}, {2, 5}}}, {99, {{1, 4}}}}, {}));
+    render(book, out);
+    CHECK(book.get_order_count() == 2);
+    CHECK(ladder(out.bid_levels) == (Ladder{{100, 5, 1}, {99, 4, 1}}));
+
+    CHECK(book.apply_delta_batch(build_batch(fbb, 2, {{fb::Kind_Remove, 1, 0, 0, fb::Side_Buy},
+                                                      {fb::Kind_Remove, 2, 0, 0, fb::Side_Buy}})) == 2);
+    render(book, out);
+    CHECK(book.get_order_count() == 0);
+    CHECK(out.bid_levels.empty());
+}
+
+static void deltas_update_levels() {
+    ::flatbuffers::FlatBufferBuilder fbb;
+    InternalOrderBookSnapshot out(10);
+    OrderBook book("TEST");
+    book.apply_snapshot(build_snapshot(fbb, 10, {{100, {{1, 10}, {2, 20}, {3, 30}}}}, {{101, {{4, 7}}}}));
+
+    const size_t applied = book.apply_delta_batch(build_batch(fbb, 11, {
+        {fb::Kind_Remove, 2, 0, 0, fb::Side_Buy},      // Middle of the level's queue
+        {fb::Kind_Modify, 3, 100, 25, fb::Side_Buy},   // Reduce in place
+        {fb::Kind_Modify, 1, 99, 10, fb::Side_Buy},    // Price change moves the order
+        {fb::Kind_Add, 5, 101, 3, fb::Side_Sell},
+        {fb::Kind_Trade, 4, 101, 2, fb::Side_Sell},    // Partial fill
+        {fb::Kind_Remove, 77, 0, 0, fb::Side_Buy},     // Unknown order: not applied
+    }));
+    CHECK(applied == 5);
+    CHECK(book.get_last_sequence() == 16);
+
+    render(book, out);
+    CHECK(ladder(out.bid_levels) == (Ladder{{100, 25, 1}, {99, 10, 1}}));
+    CHECK(ladder(out.ask_levels) == (Ladder{{101, 8, 2}}));
+    CHECK(out.last_trade_price == 101);
+    CHECK(out.last_trade_quantity == 2);
+
+    // Full fills and removes empty the levels; freed pool slots are reused by the next adds
+    book.apply_delta_batch(build_batch(fbb, 17, {
+        {fb::Kind_Trade, 4, 101, 5, fb::Side_Sell},
+        {fb::Kind_Remove, 5, 0, 0, fb::Side_Sell},
+        {fb::Kind_Add, 6, 103, 1, fb::Side_Sell},
+        {fb::Kind_Add, 7, 103, 2, fb::Side_Sell},
+        {fb::Kind_Add, 6, 104, 4, fb::Side_Sell},      // Re-used id replaces the order
+    }));
+    render(book, out);
+    CHECK(book.get_order_count() == 4);
+    CHECK(ladder(out.ask_levels) == (Ladder{{103, 2, 1}, {104, 4, 1}}));
+}
+
+// Random delta streams against a reference of resting orders: any broken
+// queue link or pool slot shows up as a wrong or lingering level
+static void random_deltas_match_reference() {
+    ::flatbuffers::FlatBufferBuilder fbb;
+    InternalOrderBookSnapshot out(64);
+    OrderBook book("TEST");
+    book.apply_snapshot(build_snapshot(fbb, 1, {}, {}));
+
+    struct RefOrder {
+        fb::Side side;
+        uint64_t price;
+        uint32_t qty;
+    };
+    std::map<uint64_t, RefOrder> reference;
+    std::mt19937_64 rng(777);
+    uint64_t seq = 2;
+
+    for (int round = 0; round < 2000; ++round) {
+        std::vector<TestEvent> events;
+        for (int i = 0; i < 20; ++i) {
+            const uint64_t id = 1 + rng() % 200;
+            const fb::Side side = rng() % 2 ? fb::Side_Buy : fb::Side_Sell;
+            const uint64_t price = side == fb::Side_Buy ? 90 + rng() % 10 : 101 + rng() % 10;
+            const uint32_t qty = static_cast<uint32_t>(1 + rng() % 50);
+            auto it = reference.find(id);
+
+            switch (rng() % 4) {
+                case 0:
+                    events.push_back({fb::Kind_Add, id, price, qty, side});
+                    reference[id] = {side, price, qty};
+                    break;
+                case 1:
+                    if (it == reference.end()) break;
+                    events.push_back({fb::Kind_Modify, id, rng() % 2 ? it->second.price : price, qty, side});
+                    it->second.price = events.back().price;
+                    it->second.qty = qty;
+                    break;
+                case 2:
+                    events.push_back({fb::Kind_Remove, id, 0, 0, side});
+                    if (it != reference.end()) reference.erase(it);
+                    break;
+                default:
+                    events.push_back({fb::Kind_Trade, id, price, qty, side});
+                    if (it == reference.end()) break;
+                    if (qty >= it->second.qty) {
+                        reference.erase(it);
+                    } else {
+                        it->second.qty -= qty;
+                    }
+                    break;
+            }
+        }
+        book.apply_delta_batch(build_batch(fbb, seq, events));
+        seq += events.size();
+
+        std::map<uint64_t, std::pair<uint64_t, uint32_t>, std::greater<uint64_t>> bids;
+        std::map<uint64_t, std::pair<uint64_t, uint32_t>> asks;
+        for (const auto& [id, order] : reference) {
+            auto& level = order.side == fb::Side_Buy ? bids[order.price] : asks[order.price];
+            level.first += order.qty;
+            level.second++;
+        }
+        Ladder expected_bids, expected_asks;
+        for (const auto& [price, level] : bids) expected_bids.emplace_back(price, level.first, level.second);
+        for (const auto& [price, level] : asks) expected_asks.emplace_back(price, level.first, level.second);
+
+        render(book, out);
+        CHECK(book.get_order_count() == reference.size());
+        CHECK(ladder(out.bid_levels) == expected_bids);
+        CHECK(ladder(out.ask_levels) == expected_asks);
+    }
+}
+
+int main() {
+    order_id_map_basics();
+    order_id_map_matches_reference();
+    order_id_map_grows();
+    snapshot_seeds_level_aggregates();
+    duplicate_snapshot_order_is_replaced();
+    deltas_update_levels();
+    random_deltas_match_reference();
+    std::printf("OrderBookTest: all checks passed\n");
+    return 0;
+}
@@ -0,0 +1,96 @@
+/**
+ * @file    SymbolSequencerTest.cpp
+ * @brief   SymbolSequencer state transitions: seeding, duplicates, overlaps, gaps, re-seeding
+ *
+ * Exits non-zero on the first failed check.
+ */
+
+#include "OrderBook.hpp"
+#include "TestCheck.hpp"
+
+using namespace market_depth;
+
+using State = SymbolSequencer::State;
+using Result = SymbolSequencer::Result;
+
+static void deltas_are_held_until_seeded() {
+    SymbolSequencer sequencer;
+    CHECK(sequencer.state() == State::Unseeded);
+    CHECK(sequencer.on_batch(1, 5) == Result::Held);
+    CHECK(sequencer.on_batch(0, 0) == Result::Held);
+
+    CHECK(sequencer.on_snapshot(10) == Result::Apply);
+    CHECK(sequencer.state() == State::Live);
+    CHECK(sequencer.next_expected() == 11);
+}
+
+static void in_sequence_duplicate_and_overlapping_batches() {
+    SymbolSequencer sequencer;
+    sequencer.on_snapshot(10);
+
+    CHECK(sequencer.on_batch(11, 15) == Result::Apply);
+    CHECK(sequencer.next_expected() == 16);
+    CHECK(sequencer.on_batch(11, 15) == Result::Duplicate);  // Replayed
+    CHECK(sequencer.on_batch(8, 10) == Result::Duplicate);   // Older than the snapshot
+    CHECK(sequencer.on_batch(14, 18) == Result::Apply);      // Overlap: caller skips 14-15
+    CHECK(sequencer.next_expected() == 19);
+    CHECK(sequencer.on_batch(0, 0) == Result::Apply);        // Unsequenced batch
+    CHECK(sequencer.next_expected() == 19);
+
+    // An older snapshot than the book already reflects is a duplicate
+    CHECK(sequencer.on_snapshot(12) == Result::Duplicate);
+    CHECK(sequencer.next_expected() == 19);
+    CHECK(sequencer.state() == State::Live);
+}
+
+static void gap_goes_stale_until_snapshot() {
+    SymbolSequencer sequencer;
+    sequencer.on_snapshot(10);
+
+    CHECK(sequencer.on_batch(13, 15) == Result::Gap);
+    CHECK(sequencer.state() == State::Stale);
+    CHECK(sequencer.gap_count() == 1);
+    CHECK(sequencer.on_batch(16, 20) == Result::Held);
+    CHECK(sequencer.on_batch(11, 12) == Result::Held);  // Late fill does not heal the book
+    CHECK(sequencer.gap_count() == 1);
+
+    // Any snapshot re-seeds a stale symbol, even one older than the gap
+    CHECK(sequencer.on_snapshot(9) == Result::Apply);
+    CHECK(sequencer.state() == State::Live);
+    CHECK(sequencer.next_expected() == 10);
+    CHECK(sequencer.on_batch(10, 12) == Result::Apply);
+}
+
+// A snapshot with seq 0 leaves the expected sequence unknown; the next
+// sequenced batch is adopted rather than reported as a gap
+static void unsequenced_snapshot_adopts_next_batch() {
+    SymbolSequencer sequencer;
+    CHECK(sequencer.on_snapshot(0) == Result::Apply);
+    CHECK(sequencer.state() == State::Live);
+    CHECK(sequencer.next_expected() == 0);
+
+    CHECK(sequencer.on_batch(0, 0) == Result::Apply);
+    CHECK(sequencer.next_expected() == 0);
+    CHECK(sequencer.on_batch(500, 510) == Result::Apply);
+    CHECK(sequencer.state() == State::Live);
+    CHECK(sequencer.gap_count() == 0);
+    CHECK(sequencer.next_expected() == 511);
+    CHECK(sequencer.on_batch(505, 510) == Result::Duplicate);
+    CHECK(sequencer.on_batch(520, 530) == Result::Gap);
+
+    // Re-seeding a live, sequenced symbol with seq 0 forgets the old position too
+    SymbolSequencer live;
+    live.on_snapshot(100);
+    CHECK(live.on_snapshot(0) == Result::Apply);
+    CHECK(live.on_batch(50, 60) == Result::Apply);
+    CHECK(live.next_expected() == 61);
+}
+
+int main() {
+    deltas_are_held_until_seeded();
+    in_sequence_duplicate_and_overlapping_batches();
+    gap_goes_stale_until_snapshot();
+    unsequenced_snapshot_adopts_next_batch();
+    std::printf("SymbolSequencerTest: all checks passed\n");
+    return 0;
+}
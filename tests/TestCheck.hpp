@@ -0,0 +1,24 @@
+/**
+ * @file    TestCheck.hpp
+ * @brief   Minimal assertion macro for the unit tests (no test framework dependency)
+ */
+
+#pragma once
+
+#ifndef TEST_CHECK_HPP_
+#define TEST_CHECK_HPP_
+
+#include <cstdio>
+#include <cstdlib>
+
+// Exits non-zero on the first failed check
+#define CHECK(condition)                                                            \
+    do {                                                                            \
+        if (!(condition)) {                                                         \
+            std::fprintf(stderr, "%s:%d: CHECK failed: %s\n", __FILE__, __LINE__,   \
+                         #condition);                                               \
+            std::exit(1);                                                           \
+        }                                                                           \
+    } while (0)
+
+#endif /* TEST_CHECK_HPP_ */
@@ -0,0 +1,72 @@
+/**
+ * @file    ThreadShardsTest.cpp
+ * @brief   Per-instance, per-thread shard ownership of the latency recorders
+ *
+ * Exits non-zero on the first failed check.
+ */
+
+#include "LatencyHistogram.hpp"
+#include "TestCheck.hpp"
+#include <optional>
+#include <thread>
+
+using namespace market_depth;
+
+// Two recorders written alternately by one thread, as consume_latency_ and
+// enqueue_latency_ are for every message
+static void alternating_recorders_keep_one_shard() {
+    PartitionLatencyRecorder consume;
+    PartitionLatencyRecorder enqueue;
+    for (int i = 0; i < 10000; ++i) {
+        consume.record(i % 4, 1000);
+        enqueue.record(i % 4, 2000);
+    }
+    CHECK(consume.thread_count() == 1);
+    CHECK(enqueue.thread_count() == 1);
+    CHECK(consume.collect(0).count() == 2500);
+    CHECK(enqueue.collect(0).count() == 2500);
+    CHECK(enqueue.collect(0).max() >= 2000);
+
+    StageLatencyRecorder first;
+    StageLatencyRecorder second;
+    for (int i = 0; i < 10000; ++i) {
+        first.record(LatencyStage::Decode, 100);
+        second.record(LatencyStage::Decode, 100);
+    }
+    CHECK(first.thread_count() == 1);
+    CHECK(second.thread_count() == 1);
+    CHECK(first.collect(LatencyStage::Decode).count() == 10000);
+}
+
+// A recorder re-created in the same storage must not inherit its predecessor's shard
+static void recreated_recorder_starts_empty() {
+    std::optional<PartitionLatencyRecorder> recorder;
+    recorder.emplace();
+    recorder->record(0, 1000);
+    recorder.reset();
+
+    recorder.emplace();
+    CHECK(recorder->thread_count() == 0);
+    recorder->record(0, 1000);
+    CHECK(recorder->thread_count() == 1);
+    CHECK(recorder->collect(0).count() == 1);
+}
+
+static void each_thread_gets_its_own_shard() {
+    PartitionLatencyRecorder recorder;
+    recorder.record(0, 1000);
+    std::thread worker([&] {
+        for (int i = 0; i < 100; ++i) recorder.record(0, 1000);
+    });
+    worker.join();
+    CHECK(recorder.thread_count() == 2);
+    CHECK(recorder.collect(0).count() == 101);
+}
+
+int main() {
+    alternating_recorders_keep_one_shard();
+    recreated_recorder_starts_empty();
+    each_thread_gets_its_own_shard();
+    std::printf("ThreadShardsTest: all checks passed\n");
+    return 0;
+}